@@ -0,0 +1,51 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Example sketch: Automatic calibration of an MCP79412 RTC.
+// Measures the RTC's drift against a reference clock and adjusts
+// the calibration register until the drift is within 1ppm.
+//
+// This example uses millis() as the reference, which is only
+// useful if the MCU's clock is known to be more accurate than the
+// RTC, e.g. a TCXO. In production, supply a function that returns
+// milliseconds from a better reference, e.g. GPS PPS pulses.
+
+#include <MCP79412RTC.h>            // https://github.com/JChristensen/MCP79412RTC
+#include <MCP79412Calibrator.h>
+#include <TimeLib.h>                // https://github.com/PaulStoffregen/Time
+
+uint32_t refMillis()
+{
+    return millis();
+}
+
+MCP79412Calibrator calibrator(RTC, refMillis);
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial.print(F("Calibration register: "));
+    Serial.println(RTC.calibRead());
+    calibrator.begin(1800, 1.0, 5);   // 30 minute measurements, 1ppm target, 5 tries
+}
+
+void loop()
+{
+    static byte lastState = CAL_IDLE;
+    static float lastDrift;
+
+    // print the results of each measurement
+    byte state = calibrator.update();
+    if (state != lastState || calibrator.drift() != lastDrift) {
+        lastState = state;
+        lastDrift = calibrator.drift();
+        Serial.print(F("State "));
+        Serial.print(state);
+        Serial.print(F(", drift "));
+        Serial.print(calibrator.drift());
+        Serial.print(F(" ppm, trim "));
+        Serial.println(calibrator.trim());
+    }
+}
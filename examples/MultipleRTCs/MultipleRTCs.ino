@@ -0,0 +1,57 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Example sketch: Several MCP79412 RTCs behind a TCA9548A I2C
+// multiplexer at address 0x70, on channels 0-3. Prints the time
+// and unique ID from each RTC every second. The first RTC is also
+// used to keep the Time library's system time.
+
+#include <MCP79412RTC.h>            // https://github.com/JChristensen/MCP79412RTC
+#include <TimeLib.h>                // https://github.com/PaulStoffregen/Time
+
+const uint8_t MUX_ADDR(0x70);       // TCA9548A address
+const uint8_t N_RTC(4);             // number of RTCs, on mux channels 0 to N_RTC-1
+
+MCP79412MuxBus bus0(rtcI2C, MUX_ADDR, 0);
+MCP79412MuxBus bus1(rtcI2C, MUX_ADDR, 1);
+MCP79412MuxBus bus2(rtcI2C, MUX_ADDR, 2);
+MCP79412MuxBus bus3(rtcI2C, MUX_ADDR, 3);
+
+MCP79412RTC rtc[N_RTC] = {
+    MCP79412RTC(bus0), MCP79412RTC(bus1), MCP79412RTC(bus2), MCP79412RTC(bus3)
+};
+
+void setup()
+{
+    Serial.begin(115200);
+    rtc[0].begin();                 // initializes the I2C bus for all the RTCs
+    rtc[0].setDefault();            // RTC.get() now reads rtc[0]
+    setSyncProvider(RTC.get);
+    if (timeStatus() != timeSet) Serial.println(F("RTC sync FAIL!"));
+}
+
+void loop()
+{
+    static time_t tLast;
+
+    time_t t = now();
+    if (t != tLast) {
+        tLast = t;
+        for (uint8_t i=0; i<N_RTC; i++) {
+            byte id[8];
+            rtc[i].idRead(id);
+            Serial.print(F("RTC "));
+            Serial.print(i);
+            Serial.print(F(" ID "));
+            for (uint8_t j=0; j<8; j++) {
+                if (id[j] < 16) Serial.print('0');
+                Serial.print(id[j], HEX);
+            }
+            Serial.print(F(" time "));
+            Serial.println(rtc[i].getTime());
+        }
+        Serial.println();
+    }
+}
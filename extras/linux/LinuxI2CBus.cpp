@@ -0,0 +1,96 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// MCP79412Bus for a Linux I2C adapter. See LinuxI2CBus.h for details.
+
+#include "LinuxI2CBus.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+LinuxI2CBus::LinuxI2CBus(int busNumber)
+    : m_busNumber(busNumber), m_fd(-1), m_addr(0), m_txLen(0), m_rxLen(0), m_rxPos(0)
+{
+}
+
+LinuxI2CBus::~LinuxI2CBus()
+{
+    if (m_fd >= 0) close(m_fd);
+}
+
+// Open the adapter. Check isOpen() to see whether this succeeded.
+void LinuxI2CBus::begin()
+{
+    char dev[32];
+
+    if (m_fd >= 0) return;
+    snprintf(dev, sizeof(dev), "/dev/i2c-%d", m_busNumber);
+    m_fd = open(dev, O_RDWR);
+}
+
+void LinuxI2CBus::beginTransmission(uint8_t addr)
+{
+    m_addr = addr;
+    m_txLen = 0;
+}
+
+size_t LinuxI2CBus::write(uint8_t value)
+{
+    if (m_txLen >= sizeof(m_txBuf)) return 0;
+    m_txBuf[m_txLen++] = value;
+    return 1;
+}
+
+// Send the bytes written since beginTransmission(). Returns the same
+// status codes as the Wire library: 0 success, 2 address NACK,
+// 3 data NACK, 4 other error.
+uint8_t LinuxI2CBus::endTransmission()
+{
+    struct i2c_msg msg;
+    struct i2c_rdwr_ioctl_data xfer;
+
+    if (m_fd < 0) return 4;
+    msg.addr = m_addr;
+    msg.flags = 0;
+    msg.len = m_txLen;
+    msg.buf = m_txBuf;
+    xfer.msgs = &msg;
+    xfer.nmsgs = 1;
+    if (ioctl(m_fd, I2C_RDWR, &xfer) >= 0) return 0;
+    if (errno == ENXIO) return 2;
+    if (errno == EREMOTEIO) return (m_txLen > 0) ? 3 : 2;
+    return 4;
+}
+
+// Read nBytes from the device. Returns the number of bytes read,
+// zero on error.
+uint8_t LinuxI2CBus::requestFrom(uint8_t addr, uint8_t nBytes)
+{
+    struct i2c_msg msg;
+    struct i2c_rdwr_ioctl_data xfer;
+
+    m_rxLen = 0;
+    m_rxPos = 0;
+    if (m_fd < 0 || nBytes == 0) return 0;
+    msg.addr = addr;
+    msg.flags = I2C_M_RD;
+    msg.len = nBytes;
+    msg.buf = m_rxBuf;
+    xfer.msgs = &msg;
+    xfer.nmsgs = 1;
+    if (ioctl(m_fd, I2C_RDWR, &xfer) < 0) return 0;
+    m_rxLen = nBytes;
+    return nBytes;
+}
+
+// Returns the next byte read by requestFrom(), or -1 if none left.
+int LinuxI2CBus::read()
+{
+    return (m_rxPos < m_rxLen) ? m_rxBuf[m_rxPos++] : -1;
+}
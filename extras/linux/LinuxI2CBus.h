@@ -0,0 +1,44 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// MCP79412Bus for a Linux I2C adapter (/dev/i2c-N), using the
+// I2C_RDWR ioctl. Transactions are the same as with the Wire library:
+// bytes written between beginTransmission() and endTransmission() go
+// out as one write message, and requestFrom() is one read message.
+
+#ifndef LINUXI2CBUS_H_INCLUDED
+#define LINUXI2CBUS_H_INCLUDED
+
+#include <MCP79412Bus.h>
+
+class LinuxI2CBus : public MCP79412Bus
+{
+    public:
+        LinuxI2CBus(int busNumber);
+        ~LinuxI2CBus();
+        void begin();
+        bool isOpen() { return m_fd >= 0; }
+        int busNumber() { return m_busNumber; }
+        void beginTransmission(uint8_t addr);
+        size_t write(uint8_t value);
+        uint8_t endTransmission();
+        uint8_t requestFrom(uint8_t addr, uint8_t nBytes);
+        int read();
+
+    private:
+        LinuxI2CBus(const LinuxI2CBus&);
+        LinuxI2CBus& operator=(const LinuxI2CBus&);
+
+        int m_busNumber;        // N in /dev/i2c-N
+        int m_fd;               // file descriptor, -1 if not open
+        uint8_t m_addr;         // address for the current write
+        uint8_t m_txBuf[256];
+        uint16_t m_txLen;
+        uint8_t m_rxBuf[256];
+        uint8_t m_rxLen;
+        uint8_t m_rxPos;
+};
+
+#endif
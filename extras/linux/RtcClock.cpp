@@ -0,0 +1,76 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// System clock and MCP79412 alignment on a Linux host. See RtcClock.h.
+
+#include "RtcClock.h"
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/timex.h>
+#include <time.h>
+
+// The RTC time minus the system time at the edge, in ns.
+int64_t rtcOffsetNs(const rtcEdge_t &edge)
+{
+    return (int64_t)edge.rtcTime * 1000000000LL - edge.realNs;
+}
+
+// Step the system clock to the RTC time, extrapolated from the edge
+// on CLOCK_MONOTONIC. Needs CAP_SYS_TIME.
+bool stepSystemClock(const rtcEdge_t &edge)
+{
+    int64_t ns = (int64_t)edge.rtcTime * 1000000000LL + (monoNs() - edge.monoNs);
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    return clock_settime(CLOCK_REALTIME, &ts) == 0;
+}
+
+// Slew the system clock by offsetNs (positive to advance it). The
+// kernel slews at 500ppm, so 1ms takes 2s. Needs CAP_SYS_TIME.
+bool slewSystemClock(int64_t offsetNs)
+{
+    struct timeval tv;
+    int64_t us = offsetNs / 1000;
+
+    tv.tv_sec = us / 1000000;
+    tv.tv_usec = us % 1000000;
+    if (tv.tv_usec < 0)
+    {
+        tv.tv_sec--;
+        tv.tv_usec += 1000000;
+    }
+    return adjtime(&tv, 0) == 0;
+}
+
+// Returns true if the kernel reports the system clock as synchronized,
+// e.g. by NTP; only then is it a good source for the RTC.
+bool systemClockSynced()
+{
+    struct timex tx = {};
+
+    return adjtimex(&tx) != TIME_ERROR && !(tx.status & STA_UNSYNC);
+}
+
+// Write the system time to the RTC at the next second boundary of the
+// system clock, less leadNs. The time the write took is returned in
+// durationNs, to be used as leadNs the next time.
+rtcStatus_t writeRtcFromSystem(MCP79412RTC &rtc, int64_t leadNs, int64_t *durationNs)
+{
+    int64_t now = realNs();
+    int64_t boundary = (now / 1000000000LL + 1) * 1000000000LL;
+    if (boundary - leadNs < now + 1000000LL) boundary += 1000000000LL;    // too close, use the next one
+    int64_t wake = boundary - leadNs;
+    struct timespec ts;
+
+    ts.tv_sec = wake / 1000000000LL;
+    ts.tv_nsec = wake % 1000000000LL;
+    while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, 0) == EINTR) {}
+    int64_t start = monoNs();
+    rtcStatus_t status = rtc.setTime(boundary / 1000000000LL);
+    if (durationNs) *durationNs = monoNs() - start;
+    return status;
+}
@@ -0,0 +1,33 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Setting the Linux system clock from an MCP79412, and the RTC from
+// the system clock, with sub-second alignment, for rtcsync and other
+// programs that keep the two in step.
+//
+// The system clock is set from a seconds edge of the RTC (see
+// RtcEdge.h), at which the RTC time is known to the edge uncertainty
+// rather than only to the second, as when the time is just read.
+// It is stepped with clock_settime(), or slewed with adjtime().
+//
+// The RTC is written at a second boundary of the system clock. The
+// MCP79412 restarts its oscillator, and so its count of the second,
+// when the seconds register is written with the ST bit set, so the
+// RTC's seconds then change in step with the system clock's. The
+// write is started early by the time it takes (leadNs), so that the
+// seconds register is written at the boundary.
+
+#ifndef RTCCLOCK_H_INCLUDED
+#define RTCCLOCK_H_INCLUDED
+
+#include "RtcEdge.h"
+
+int64_t rtcOffsetNs(const rtcEdge_t &edge);
+bool stepSystemClock(const rtcEdge_t &edge);
+bool slewSystemClock(int64_t offsetNs);
+bool systemClockSynced();
+rtcStatus_t writeRtcFromSystem(MCP79412RTC &rtc, int64_t leadNs, int64_t *durationNs);
+
+#endif
@@ -0,0 +1,192 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Seconds edge of an MCP79412 on a Linux host. See RtcEdge.h.
+
+#include "RtcEdge.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#define NS_PER_S 1000000000LL
+#define POLL_LEAD_NS 20000000LL     // start polling this long before the edge is due
+#define COARSE_NS 10000000LL        // time between reads when finding the edge
+#define MAX_PREDICT_NS (60 * NS_PER_S)  // longest time from the last edge to predict the next one from it
+#define EDGE_TIMEOUT_MS 1500        // longest wait for an edge
+#define EVENT_BUF 16                // GPIO events read at once
+#define MAX_EVENT_AGE_NS 900000000LL    // oldest GPIO event to pair with an RTC read
+
+static int64_t clockNs(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int64_t monoNs() { return clockNs(CLOCK_MONOTONIC); }
+int64_t realNs() { return clockNs(CLOCK_REALTIME); }
+
+RtcEdge::RtcEdge(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_gpioFd(-1), m_lastMonoNs(0)
+{
+}
+
+RtcEdge::~RtcEdge()
+{
+    if (m_gpioFd >= 0) close(m_gpioFd);
+}
+
+// Use the MFP on the given line of a GPIO chip (e.g. /dev/gpiochip0),
+// and turn on the RTC's 1Hz square wave. rising is the edge at which
+// the seconds change. Returns false if the line cannot be requested
+// or the square wave turned on.
+bool RtcEdge::openGpio(const char *chip, unsigned line, bool rising)
+{
+    struct gpio_v2_line_request req;
+    int fd = open(chip, O_RDONLY);
+
+    if (fd < 0) return false;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    strncpy(req.consumer, "mcp79412 mfp", sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+        (rising ? GPIO_V2_LINE_FLAG_EDGE_RISING : GPIO_V2_LINE_FLAG_EDGE_FALLING);
+    int ret = ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(fd);
+    if (ret < 0) return false;
+    if (m_rtc.squareWave(SQWAVE_1_HZ) != RTC_OK)
+    {
+        close(req.fd);
+        return false;
+    }
+    if (m_gpioFd >= 0) close(m_gpioFd);
+    m_gpioFd = req.fd;
+    return true;
+}
+
+// Wait for the next seconds edge. Returns false if there was none
+// within 1.5s, or the RTC could not be read (see the RTC's
+// lastStatus()).
+bool RtcEdge::wait(rtcEdge_t &edge)
+{
+    return usingGpio() ? waitGpio(edge) : waitPoll(edge);
+}
+
+// The kernel timestamps the edge on CLOCK_MONOTONIC; the real time
+// is taken from the offset between the clocks just after. The kernel
+// queues the edges that come while the caller is not waiting, so they
+// are all read and only the newest is used, and one that is too old
+// to be paired with the RTC time read now is skipped.
+bool RtcEdge::waitGpio(rtcEdge_t &edge)
+{
+    struct pollfd pfd;
+    struct gpio_v2_line_event ev[EVENT_BUF];
+    tmElements_t tm;
+    uint64_t stamp;
+    int64_t deadline = monoNs() + EDGE_TIMEOUT_MS * 1000000LL;
+
+    pfd.fd = m_gpioFd;
+    pfd.events = POLLIN;
+    do
+    {
+        int64_t left = deadline - monoNs();
+        if (left <= 0 || poll(&pfd, 1, (int)(left / 1000000)) != 1) return false;
+        do
+        {
+            ssize_t n = read(m_gpioFd, ev, sizeof(ev));
+            if (n < (ssize_t)sizeof(ev[0])) return false;
+            stamp = ev[n / sizeof(ev[0]) - 1].timestamp_ns;
+        } while (poll(&pfd, 1, 0) == 1);
+    } while (monoNs() - (int64_t)stamp > MAX_EVENT_AGE_NS);
+    int64_t real = realNs();
+    int64_t mono = monoNs();
+    if (!m_rtc.read(tm)) return false;
+
+    edge.rtcTime = makeTime(tm);
+    edge.monoNs = stamp;
+    edge.realNs = real - (mono - (int64_t)stamp);
+    edge.uncertaintyNs = 0;
+    m_lastMonoNs = edge.monoNs;
+    return true;
+}
+
+// Sleep until shortly before the next edge is due, a whole number of
+// seconds after the last one, then read until the seconds change.
+bool RtcEdge::waitPoll(rtcEdge_t &edge)
+{
+    tmElements_t tm;
+    time_t first, t;
+    int64_t prevMid, mid, before, after;
+    int64_t now = monoNs();
+
+    if (m_lastMonoNs == 0 || now - m_lastMonoNs > MAX_PREDICT_NS)
+    {
+        if (!findEdge()) return false;
+        now = monoNs();
+    }
+    int64_t next = m_lastMonoNs + ((now - m_lastMonoNs) / NS_PER_S + 1) * NS_PER_S;
+    int64_t sleepNs = next - POLL_LEAD_NS - now;
+    if (sleepNs > 0)
+    {
+        struct timespec ts = { 0, (long)sleepNs };
+        nanosleep(&ts, 0);
+    }
+
+    before = monoNs();
+    if (!m_rtc.read(tm)) return false;
+    after = monoNs();
+    first = makeTime(tm);
+    mid = before + (after - before) / 2;
+    int64_t deadline = before + EDGE_TIMEOUT_MS * 1000000LL;
+    do
+    {
+        prevMid = mid;
+        before = monoNs();
+        if (!m_rtc.read(tm)) return false;
+        after = monoNs();
+        t = makeTime(tm);
+        mid = before + (after - before) / 2;
+        if (after > deadline) return false;
+    } while (t == first);
+
+    int64_t real = realNs();
+    int64_t mono = monoNs();
+    edge.rtcTime = t;
+    edge.monoNs = prevMid + (mid - prevMid) / 2;
+    edge.realNs = real - (mono - edge.monoNs);
+    edge.uncertaintyNs = (mid - prevMid) / 2;
+    m_lastMonoNs = edge.monoNs;
+    return true;
+}
+
+// Find the seconds edge to within COARSE_NS, by reads that far apart,
+// and take it as the last edge. The edge is after the read before the
+// change, and no later than the start of the read that saw it.
+bool RtcEdge::findEdge()
+{
+    tmElements_t tm;
+    struct timespec ts = { 0, (long)COARSE_NS };
+
+    if (!m_rtc.read(tm)) return false;
+    time_t first = makeTime(tm);
+    int64_t deadline = monoNs() + EDGE_TIMEOUT_MS * 1000000LL;
+    for (;;)
+    {
+        nanosleep(&ts, 0);
+        int64_t before = monoNs();
+        if (!m_rtc.read(tm)) return false;
+        if (makeTime(tm) != first)
+        {
+            m_lastMonoNs = before;
+            return true;
+        }
+        if (before > deadline) return false;
+    }
+}
@@ -0,0 +1,67 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Waits for the seconds of an MCP79412 to change, and reports when
+// they did on the host's clocks, for the Linux tools that align the
+// host to the RTC (rtcshmd and the like).
+//
+// With a GPIO line wired to the RTC's MFP (open drain, with a pull-up)
+// the RTC's 1Hz square wave is used: the edge is timestamped by the
+// kernel when it happens, through the GPIO character device, and the
+// time is read from the RTC just after it. The edge that coincides
+// with the seconds changing is given by the caller; see README.md
+// for how to check it. Setting up the GPIO turns on the square wave,
+// so the MFP cannot be used for alarms at the same time. Edges that
+// came between calls are discarded, so wait() always reports the
+// latest one, and one more than 0.9s old is skipped for the next.
+//
+// Without a GPIO, the time is read back-to-back until the seconds
+// change, starting shortly before the change is due, and the edge is
+// taken to be halfway between the last two reads. The uncertainty is
+// then about half the time of a read, e.g. 120us at 400kHz. The
+// change is expected a whole number of seconds after the last edge;
+// if there is none, or it was more than a minute ago, the edge is
+// first found to within 10ms by reads 10ms apart, which adds up to
+// a second to the wait.
+
+#ifndef RTCEDGE_H_INCLUDED
+#define RTCEDGE_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <stdint.h>
+
+// A seconds edge of the RTC
+struct rtcEdge_t {
+    time_t rtcTime;             // RTC time from the edge on
+    int64_t monoNs;             // CLOCK_MONOTONIC at the edge
+    int64_t realNs;             // CLOCK_REALTIME at the edge
+    uint32_t uncertaintyNs;     // the edge is within this of monoNs
+};
+
+class RtcEdge
+{
+    public:
+        RtcEdge(MCP79412RTC &rtc);
+        ~RtcEdge();
+        bool openGpio(const char *chip, unsigned line, bool rising);
+        bool usingGpio() { return m_gpioFd >= 0; }
+        bool wait(rtcEdge_t &edge);
+
+    private:
+        RtcEdge(const RtcEdge&);
+        RtcEdge& operator=(const RtcEdge&);
+        bool waitGpio(rtcEdge_t &edge);
+        bool waitPoll(rtcEdge_t &edge);
+        bool findEdge();
+
+        MCP79412RTC &m_rtc;
+        int m_gpioFd;               // line request, -1 if polling
+        int64_t m_lastMonoNs;       // monoNs of the last edge, 0 if none
+};
+
+int64_t monoNs();
+int64_t realNs();
+
+#endif
@@ -0,0 +1,112 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// The shared-memory page published by rtcshmd, and the function to
+// read it. rtcshmd reads the RTC once a second, at its seconds edge
+// (see RtcEdge.h), and publishes the RTC time with the host's clocks
+// at that edge. A reader maps the page read-only and calls
+// rtcShmRead(), which takes no locks and makes no system calls
+// (clock_gettime() is in the vDSO), so any number of processes can
+// get the RTC time without touching the bus.
+//
+// The page is protected by a sequence lock: rtcshmd makes seq odd
+// while it updates the page and even again when done, and a reader
+// copies the page and tries again if seq was odd or changed. There
+// must be only one writer, so rtcshmd holds an exclusive flock() on
+// the page.
+//
+//   int fd = shm_open(RTC_SHM_NAME, O_RDONLY, 0);
+//   const rtcShm_t *shm = (const rtcShm_t*)mmap(0, sizeof(rtcShm_t),
+//       PROT_READ, MAP_SHARED, fd, 0);
+//   rtcShmSample_t s;
+//   if (rtcShmRead(shm, s) && s.valid) ... rtcShmNow(s) ...
+
+#ifndef RTCSHM_H_INCLUDED
+#define RTCSHM_H_INCLUDED
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define RTC_SHM_NAME "/mcp79412rtc"     // default name, for shm_open()
+#define RTC_SHM_MAGIC 0x4D435054        // "MCPT"
+#define RTC_SHM_VERSION 1
+
+// How the edge was found
+enum {
+    RTC_SHM_POLL,       // by reading the RTC until the seconds changed
+    RTC_SHM_GPIO        // from the MFP's 1Hz square wave
+};
+
+// The published data
+struct rtcShmSample_t {
+    int64_t rtcTime;            // RTC time (time_t) from the edge on
+    int64_t monoNs;             // CLOCK_MONOTONIC at the edge
+    int64_t realNs;             // CLOCK_REALTIME at the edge
+    uint32_t uncertaintyNs;     // the edge is within this of monoNs
+    uint32_t updates;           // edges published
+    uint32_t errors;            // failed RTC reads or missed edges
+    uint8_t status;             // rtcStatus_t of the last RTC read
+    uint8_t source;             // RTC_SHM_POLL or RTC_SHM_GPIO
+    uint8_t valid;              // rtcTime and the clocks are set
+    uint8_t reserved;
+};
+
+// The shared-memory page
+struct rtcShm_t {
+    uint32_t magic;             // RTC_SHM_MAGIC once initialized
+    uint32_t version;           // RTC_SHM_VERSION
+    std::atomic<uint32_t> seq;  // odd while the sample is being written
+    uint32_t reserved;
+    rtcShmSample_t sample;
+};
+
+// Copy the sample from the page. Returns false if the page is not
+// initialized, or is being written continuously (rtcshmd writes it
+// once a second, so a few tries are always enough).
+inline bool rtcShmRead(const rtcShm_t *shm, rtcShmSample_t &sample)
+{
+    if (shm->magic != RTC_SHM_MAGIC || shm->version != RTC_SHM_VERSION) return false;
+    for (int tries=0; tries<1000; tries++)
+    {
+        uint32_t seq = shm->seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;
+        memcpy(&sample, &shm->sample, sizeof(sample));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (shm->seq.load(std::memory_order_relaxed) == seq) return true;
+    }
+    return false;
+}
+
+// Make seq even, as the writer must before its first write: a writer
+// that died during rtcShmWrite() leaves it odd (rtcshmd).
+inline void rtcShmReset(rtcShm_t *shm)
+{
+    uint32_t seq = shm->seq.load(std::memory_order_relaxed);
+    shm->seq.store((seq + 1) & ~1u, std::memory_order_release);
+}
+
+// Write a sample to the page (rtcshmd).
+inline void rtcShmWrite(rtcShm_t *shm, const rtcShmSample_t &sample)
+{
+    uint32_t seq = shm->seq.load(std::memory_order_relaxed);
+    shm->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&shm->sample, &sample, sizeof(sample));
+    shm->seq.store(seq + 2, std::memory_order_release);
+}
+
+// The RTC time now in ns since 1970, extrapolated from the sample on
+// CLOCK_MONOTONIC.
+inline int64_t rtcShmNow(const rtcShmSample_t &sample)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t mono = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    return sample.rtcTime * 1000000000LL + (mono - sample.monoNs);
+}
+
+#endif
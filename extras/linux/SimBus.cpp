@@ -0,0 +1,127 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// An MCP79412Bus with a simulated MCP79412 on it. See SimBus.h.
+
+#include "SimBus.h"
+#include "SimPort.h"
+#include <string.h>
+
+static SimBus *simClock;        // the SimBus whose time is the driver's clock
+
+SimBus::SimBus(uint32_t sclHz)
+    : m_sclHz(sclHz), m_addr(0), m_txLen(0), m_rxLen(0), m_rxPos(0),
+      m_rtcPtr(0), m_eepromPtr(0), m_eepromReadyNs(0), m_nowNs(0)
+{
+    memset(rtcMem, 0, sizeof(rtcMem));
+    memset(eepromMem, 0xFF, sizeof(eepromMem));
+    for (uint8_t i=0; i<8; i++) eepromMem[0xF0 + i] = 0x10 + i;
+    resetStats();
+    simClock = this;
+}
+
+SimBus::~SimBus()
+{
+    if (simClock == this) simClock = 0;
+}
+
+uint32_t simMicros()
+{
+    return simClock ? simClock->nowNs() / 1000 : 0;
+}
+
+void simDelayUs(uint32_t us)
+{
+    if (simClock) simClock->idle((uint64_t)us * 1000);
+}
+
+void SimBus::resetStats()
+{
+    m_busNs = 0;
+    m_starts = 0;
+    m_bytes = 0;
+    m_nacks = 0;
+}
+
+// Account for one transaction of nBytes, including the address byte.
+void SimBus::transaction(uint16_t nBytes)
+{
+    uint64_t ns = (uint64_t)(9 * nBytes + 2) * 1000000000ULL / m_sclHz;
+
+    m_starts++;
+    m_bytes += nBytes;
+    m_busNs += ns;
+    m_nowNs += ns;
+}
+
+void SimBus::beginTransmission(uint8_t addr)
+{
+    m_addr = addr;
+    m_txLen = 0;
+}
+
+size_t SimBus::write(uint8_t value)
+{
+    if (m_txLen >= sizeof(m_txBuf)) return 0;
+    m_txBuf[m_txLen++] = value;
+    return 1;
+}
+
+uint8_t SimBus::endTransmission()
+{
+    bool rtc = (m_addr == SIM_RTC_ADDR);
+
+    if ( !(rtc || m_addr == SIM_EEPROM_ADDR) || (!rtc && eepromBusy()) )
+    {
+        transaction(1);
+        m_nacks++;
+        return 2;
+    }
+    transaction(1 + m_txLen);
+    if (m_txLen == 0) return 0;
+
+    if (rtc)
+    {
+        m_rtcPtr = m_txBuf[0];
+        for (uint16_t i=1; i<m_txLen; i++) rtcMem[m_rtcPtr++] = m_txBuf[i];
+    }
+    else
+    {
+        // writes wrap around within the 8-byte page
+        m_eepromPtr = m_txBuf[0];
+        uint8_t page = m_eepromPtr & ~7;
+        for (uint16_t i=1; i<m_txLen; i++)
+        {
+            eepromMem[page | (m_eepromPtr & 7)] = m_txBuf[i];
+            m_eepromPtr = page | ((m_eepromPtr + 1) & 7);
+        }
+        if (m_txLen > 1) m_eepromReadyNs = m_nowNs + SIM_EEPROM_WRITE_NS;
+    }
+    return 0;
+}
+
+uint8_t SimBus::requestFrom(uint8_t addr, uint8_t nBytes)
+{
+    bool rtc = (addr == SIM_RTC_ADDR);
+
+    m_rxLen = 0;
+    m_rxPos = 0;
+    if ( !(rtc || addr == SIM_EEPROM_ADDR) || (!rtc && eepromBusy()) )
+    {
+        transaction(1);
+        m_nacks++;
+        return 0;
+    }
+    transaction(1 + nBytes);
+    for (uint8_t i=0; i<nBytes; i++)
+        m_rxBuf[i] = rtc ? rtcMem[m_rtcPtr++] : eepromMem[m_eepromPtr++];
+    m_rxLen = nBytes;
+    return nBytes;
+}
+
+int SimBus::read()
+{
+    return (m_rxPos < m_rxLen) ? m_rxBuf[m_rxPos++] : -1;
+}
@@ -0,0 +1,76 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// An MCP79412Bus with a simulated MCP79412 on it: the RTC registers
+// and SRAM at 0x6F, the EEPROM and unique ID at 0x57. The simulation
+// keeps a model of the bus time at a given SCL frequency, from the
+// bits each transaction puts on the wire, and uses it to time the
+// EEPROM write cycle, during which the EEPROM does not acknowledge
+// its address, as the real part does. The RTC does not tick.
+//
+// The bus time model counts, for each transaction, a START, nine bit
+// times (eight bits and ACK) for the address and for each byte
+// transferred, and a STOP, with START and STOP one bit time each.
+// An address that is not acknowledged ends the transaction.
+//
+// The modeled time of the SimBus constructed last is also the clock
+// for the driver when it is built with SimPort.h; a delay by the
+// driver leaves the bus idle for that long.
+
+#ifndef SIMBUS_H_INCLUDED
+#define SIMBUS_H_INCLUDED
+
+#include <MCP79412Bus.h>
+
+#define SIM_RTC_ADDR 0x6F
+#define SIM_EEPROM_ADDR 0x57
+#define SIM_EEPROM_WRITE_NS 5000000UL   // EEPROM write cycle time, 5ms max per datasheet
+
+class SimBus : public MCP79412Bus
+{
+    public:
+        SimBus(uint32_t sclHz = 100000);
+        ~SimBus();
+        void begin() {}
+        void beginTransmission(uint8_t addr);
+        size_t write(uint8_t value);
+        uint8_t endTransmission();
+        uint8_t requestFrom(uint8_t addr, uint8_t nBytes);
+        int read();
+
+        void setClock(uint32_t sclHz) { m_sclHz = sclHz; }
+        void resetStats();
+        uint32_t starts() { return m_starts; }          // transactions, including those NACKed
+        uint32_t bytes() { return m_bytes; }            // bytes on the wire, including address bytes
+        uint32_t nacks() { return m_nacks; }
+        uint64_t busNs() { return m_busNs; }            // modeled bus time since resetStats()
+        uint64_t nowNs() { return m_nowNs; }            // modeled time since construction
+        void idle(uint64_t ns) { m_nowNs += ns; }       // let time pass with the bus idle
+
+        uint8_t rtcMem[256];        // RTC registers 0x00-0x1F, SRAM 0x20-0x5F
+        uint8_t eepromMem[256];     // EEPROM 0x00-0x7F, unique ID 0xF0-0xF7
+
+    private:
+        void transaction(uint16_t nBytes);
+        bool eepromBusy() { return m_nowNs < m_eepromReadyNs; }
+
+        uint32_t m_sclHz;
+        uint8_t m_addr;             // address for the current write
+        uint8_t m_txBuf[256];
+        uint16_t m_txLen;
+        uint8_t m_rxBuf[256];
+        uint8_t m_rxLen;
+        uint8_t m_rxPos;
+        uint8_t m_rtcPtr;           // register pointers
+        uint8_t m_eepromPtr;
+        uint64_t m_eepromReadyNs;   // end of the EEPROM write cycle
+        uint64_t m_nowNs;
+        uint64_t m_busNs;
+        uint32_t m_starts;
+        uint32_t m_bytes;
+        uint32_t m_nacks;
+};
+
+#endif
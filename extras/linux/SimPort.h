@@ -0,0 +1,23 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Runs the driver on the simulation's modeled time (see SimBus.h)
+// instead of the host's clock, so that the EEPROM timeout, retry
+// backoff and EEPROM polling waits of the driver take modeled time,
+// and the results of rtcbench do not depend on the host. rtcbench
+// builds the driver with -include SimPort.h; see MCP79412Port.h.
+
+#ifndef SIMPORT_H_INCLUDED
+#define SIMPORT_H_INCLUDED
+
+#include <stdint.h>
+
+uint32_t simMicros();
+void simDelayUs(uint32_t us);
+
+#define MCP79412RTC_MICROS() simMicros()
+#define MCP79412RTC_DELAY_US(us) simDelayUs(us)
+
+#endif
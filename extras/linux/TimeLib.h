@@ -0,0 +1,58 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// The parts of PJRC's Time library used by the MCP79412RTC driver,
+// implemented with the C library, so the driver can be built for a
+// Linux host. Not a replacement for the Time library in general.
+
+#ifndef _Time_h
+#define _Time_h
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct {
+    uint8_t Second;
+    uint8_t Minute;
+    uint8_t Hour;
+    uint8_t Wday;       // day of week, sunday is day 1
+    uint8_t Day;
+    uint8_t Month;
+    uint8_t Year;       // offset from 1970
+} tmElements_t;
+
+#define tmNbrFields (sizeof(tmElements_t) / sizeof(uint8_t))
+#define tmYearToCalendar(Y) ((Y) + 1970)
+#define CalendarYrToTm(Y) ((Y) - 1970)
+#define tmYearToY2k(Y) ((Y) - 30)
+#define y2kYearToTm(Y) ((Y) + 30)
+#define SECS_PER_DAY ((time_t)86400UL)
+
+inline time_t makeTime(const tmElements_t &tm)
+{
+    struct tm t = {};
+    t.tm_year = tm.Year + 70;
+    t.tm_mon = tm.Month - 1;
+    t.tm_mday = tm.Day;
+    t.tm_hour = tm.Hour;
+    t.tm_min = tm.Minute;
+    t.tm_sec = tm.Second;
+    return timegm(&t);
+}
+
+inline void breakTime(time_t time, tmElements_t &tm)
+{
+    struct tm t;
+    gmtime_r(&time, &t);
+    tm.Second = t.tm_sec;
+    tm.Minute = t.tm_min;
+    tm.Hour = t.tm_hour;
+    tm.Wday = t.tm_wday + 1;
+    tm.Day = t.tm_mday;
+    tm.Month = t.tm_mon + 1;
+    tm.Year = t.tm_year - 70;
+}
+
+#endif
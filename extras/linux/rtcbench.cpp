@@ -0,0 +1,331 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// rtcbench: measure the bus cost of each MCP79412RTC function.
+//
+// Each function is called against a simulated MCP79412 (see SimBus.h)
+// at SCL frequencies of 100kHz, 400kHz and 1MHz, and the number of
+// transactions (START conditions), the bytes on the wire (including
+// address bytes) at 400kHz and the modeled bus time at each frequency
+// are reported, with the host CPU time per call. The bus figures are
+// deterministic, so they can be compared against a baseline file; any
+// that is higher than in the baseline is a regression and makes the
+// exit status 1. CPU time depends on the host and is not compared.
+//
+// usage: rtcbench [-b baseline] [-w baseline] [-n iterations]
+//        rtcbench -t function -o trace
+//   -b  compare against a baseline file
+//   -w  write the results to a baseline file
+//   -n  calls per function for the CPU time, default 1000
+//   -t  record a bus trace (see MCP79412Trace.h) of one call of the
+//       function at 400kHz to the file given with -o, e.g. for rtcvcd
+
+#include <MCP79412RTC.h>
+#include <MCP79412Trace.h>
+#include "SimBus.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+
+#define N_CLOCKS 3
+static const uint32_t sclHz[N_CLOCKS] = { 100000, 400000, 1000000 };
+#define REF_CLOCK 1             // index of the clock for starts and bytes
+
+static byte buf[32];
+static byte lgState[8];
+static time_t t1, t2;
+static tmElements_t tm;
+
+static void bGet(MCP79412RTC &rtc) { rtc.getTime(); }
+static void bSet(MCP79412RTC &rtc) { rtc.setTime(1700000000); }
+static void bRead(MCP79412RTC &rtc) { rtc.read(tm); }
+static void bWrite(MCP79412RTC &rtc) { rtc.write(tm); }
+static void bSramRead1(MCP79412RTC &rtc) { rtc.sramRead(0); }
+static void bSramRead32(MCP79412RTC &rtc) { rtc.sramRead(0, buf, 32); }
+static void bSramWrite1(MCP79412RTC &rtc) { rtc.sramWrite(0, 0x55); }
+static void bSramWrite31(MCP79412RTC &rtc) { rtc.sramWrite(0, buf, 31); }
+static void bEepromRead1(MCP79412RTC &rtc) { rtc.eepromRead(0); }
+static void bEepromRead32(MCP79412RTC &rtc) { rtc.eepromRead(0, buf, 32); }
+static void bEepromWrite1(MCP79412RTC &rtc) { rtc.eepromWrite(0, 0x55); }
+static void bEepromWrite8(MCP79412RTC &rtc) { rtc.eepromWrite(0, buf, 8); }
+static void bEepromWrite1A(MCP79412RTC &rtc) { rtc.setEepromPolling(EEPROM_POLL_ADAPTIVE); rtc.eepromWrite(0, 0x55); }
+static void bEepromWrite8A(MCP79412RTC &rtc) { rtc.setEepromPolling(EEPROM_POLL_ADAPTIVE); rtc.eepromWrite(0, buf, 8); }
+static void bCalibRead(MCP79412RTC &rtc) { rtc.calibRead(); }
+static void bCalibWrite(MCP79412RTC &rtc) { rtc.calibWrite(-5); }
+static void bIdRead(MCP79412RTC &rtc) { rtc.idRead(buf); }
+static void bGetEUI64(MCP79412RTC &rtc) { rtc.getEUI64(buf); }
+static void bPowerFail(MCP79412RTC &rtc) { rtc.powerFail(&t1, &t2); }
+static void bSquareWave(MCP79412RTC &rtc) { rtc.squareWave(SQWAVE_1_HZ); }
+static void bSetAlarm(MCP79412RTC &rtc) { rtc.setAlarm(ALARM_0, 1700000060); }
+static void bEnableAlarm(MCP79412RTC &rtc) { rtc.enableAlarm(ALARM_0, ALM_MATCH_DATETIME); }
+static void bAlarm(MCP79412RTC &rtc) { rtc.alarm(ALARM_0); }
+static void bOut(MCP79412RTC &rtc) { rtc.out(true); }
+static void bAlarmPolarity(MCP79412RTC &rtc) { rtc.alarmPolarity(true); }
+static void bIsRunning(MCP79412RTC &rtc) { rtc.isRunning(); }
+static void bVbaten(MCP79412RTC &rtc) { rtc.vbaten(true); }
+static void bLastGaspSave(MCP79412RTC &rtc) { rtc.lastGaspSave(); }
+static void bLastGaspRestore(MCP79412RTC &rtc) { rtc.lastGaspSave(); rtc.lastGaspRestore(&t1, &t2); }
+
+struct Bench
+{
+    const char *name;
+    void (*run)(MCP79412RTC &rtc);
+};
+
+static const Bench benches[] = {
+    { "get", bGet },
+    { "set", bSet },
+    { "read", bRead },
+    { "write", bWrite },
+    { "sramRead/1", bSramRead1 },
+    { "sramRead/32", bSramRead32 },
+    { "sramWrite/1", bSramWrite1 },
+    { "sramWrite/31", bSramWrite31 },
+    { "eepromRead/1", bEepromRead1 },
+    { "eepromRead/32", bEepromRead32 },
+    { "eepromWrite/1", bEepromWrite1 },
+    { "eepromWrite/8", bEepromWrite8 },
+    { "eepromWrite/1/adaptive", bEepromWrite1A },
+    { "eepromWrite/8/adaptive", bEepromWrite8A },
+    { "calibRead", bCalibRead },
+    { "calibWrite", bCalibWrite },
+    { "idRead", bIdRead },
+    { "getEUI64", bGetEUI64 },
+    { "powerFail", bPowerFail },
+    { "squareWave", bSquareWave },
+    { "setAlarm", bSetAlarm },
+    { "enableAlarm", bEnableAlarm },
+    { "alarm", bAlarm },
+    { "out", bOut },
+    { "alarmPolarity", bAlarmPolarity },
+    { "isRunning", bIsRunning },
+    { "vbaten", bVbaten },
+    { "lastGaspSave", bLastGaspSave },
+    { "lastGaspSave+Restore", bLastGaspRestore },
+};
+#define N_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+// The bus figures for one function, as kept in the baseline file.
+struct Result
+{
+    unsigned long starts;
+    unsigned long bytes;
+    unsigned long busUs[N_CLOCKS];
+};
+
+// Put the RTC in a known state: time set and running, a last-gasp
+// frame registered.
+static void setup(MCP79412RTC &rtc)
+{
+    breakTime(1700000000, tm);
+    rtc.write(tm);
+    rtc.lastGaspBegin(0x20, lgState, sizeof(lgState));
+}
+
+// Call the function at each clock frequency. The first call after
+// setup() is not counted, so that each function is measured in the
+// state it leaves the RTC in, as when it is called repeatedly.
+static Result measure(const Bench &b)
+{
+    Result r;
+
+    for (int c=0; c<N_CLOCKS; c++)
+    {
+        SimBus sim(sclHz[c]);
+        MCP79412RTC rtc(sim, true);
+        setup(rtc);
+        b.run(rtc);
+        sim.resetStats();
+        b.run(rtc);
+        r.busUs[c] = (sim.busNs() + 500) / 1000;
+        if (c == REF_CLOCK)
+        {
+            r.starts = sim.starts();
+            r.bytes = sim.bytes();
+        }
+    }
+    return r;
+}
+
+static void traceWriter(const uint8_t *data, uint8_t nBytes, void *context)
+{
+    fwrite(data, 1, nBytes, (FILE*)context);
+}
+
+// Record a trace of one call of a function, measured as by measure().
+static bool recordTrace(const Bench &b, const char *file)
+{
+    FILE *f = fopen(file, "wb");
+
+    if (!f) return false;
+    SimBus sim(sclHz[REF_CLOCK]);
+    MCP79412RTC rtc(sim, true);
+    setup(rtc);
+    b.run(rtc);
+    MCP79412RecordBus rec(sim, traceWriter, f);
+    MCP79412RTC traced(rec);
+    traced.lastGaspBegin(0x20, lgState, sizeof(lgState));
+    b.run(traced);
+    return fclose(f) == 0;
+}
+
+static double cpuNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Host CPU time per call in ns, including the simulation.
+static double measureCpu(const Bench &b, int iterations)
+{
+    SimBus sim(sclHz[REF_CLOCK]);
+    MCP79412RTC rtc(sim, true);
+    setup(rtc);
+    double t0 = cpuNs();
+    for (int i=0; i<iterations; i++) b.run(rtc);
+    return (cpuNs() - t0) / iterations;
+}
+
+// Read a baseline file. Each line is a function name followed by the
+// Result figures; lines starting with # are ignored.
+static bool readBaseline(const char *file, std::map<std::string, Result> &baseline)
+{
+    FILE *f = fopen(file, "r");
+    char line[256], name[64];
+
+    if (!f) return false;
+    while (fgets(line, sizeof(line), f))
+    {
+        Result r;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%63s %lu %lu %lu %lu %lu", name, &r.starts, &r.bytes,
+            &r.busUs[0], &r.busUs[1], &r.busUs[2]) == 2 + 1 + N_CLOCKS)
+        {
+            baseline[name] = r;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool writeBaseline(const char *file, const Result *results)
+{
+    FILE *f = fopen(file, "w");
+
+    if (!f) return false;
+    fprintf(f, "# rtcbench baseline: function, starts and bytes at 400kHz, bus us at 100kHz, 400kHz, 1MHz\n");
+    for (size_t i=0; i<N_BENCHES; i++)
+    {
+        const Result &r = results[i];
+        fprintf(f, "%s %lu %lu %lu %lu %lu\n", benches[i].name, r.starts, r.bytes,
+            r.busUs[0], r.busUs[1], r.busUs[2]);
+    }
+    return fclose(f) == 0;
+}
+
+// Returns true if any figure in r is higher than in the baseline.
+static bool regressed(const Result &r, const Result &base)
+{
+    if (r.starts > base.starts || r.bytes > base.bytes) return true;
+    for (int c=0; c<N_CLOCKS; c++)
+        if (r.busUs[c] > base.busUs[c]) return true;
+    return false;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: rtcbench [-b baseline] [-w baseline] [-n iterations]\n"
+        "       rtcbench -t function -o trace\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *baselineFile = 0;
+    const char *writeFile = 0;
+    const char *traceFunction = 0;
+    const char *traceFile = 0;
+    int iterations = 1000;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "b:w:n:t:o:")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'b': baselineFile = optarg; break;
+            case 'w': writeFile = optarg; break;
+            case 'n': iterations = atoi(optarg); break;
+            case 't': traceFunction = optarg; break;
+            case 'o': traceFile = optarg; break;
+            default: usage();
+        }
+    }
+    if (optind != argc || iterations < 1 || !traceFunction != !traceFile) usage();
+
+    if (traceFunction)
+    {
+        for (size_t i=0; i<N_BENCHES; i++)
+        {
+            if (strcmp(benches[i].name, traceFunction) != 0) continue;
+            if (recordTrace(benches[i], traceFile)) return 0;
+            fprintf(stderr, "rtcbench: cannot write %s\n", traceFile);
+            return 2;
+        }
+        fprintf(stderr, "rtcbench: no function %s\n", traceFunction);
+        return 2;
+    }
+
+    std::map<std::string, Result> baseline;
+    if (baselineFile && !readBaseline(baselineFile, baseline))
+    {
+        fprintf(stderr, "rtcbench: cannot read %s\n", baselineFile);
+        return 2;
+    }
+
+    Result results[N_BENCHES];
+    int nRegressed = 0;
+    printf("%-22s %6s %6s %9s %9s %9s %9s\n", "function", "starts", "bytes",
+        "us@100k", "us@400k", "us@1M", "cpu ns");
+    for (size_t i=0; i<N_BENCHES; i++)
+    {
+        const Bench &b = benches[i];
+        Result &r = results[i];
+        r = measure(b);
+        double ns = measureCpu(b, iterations);
+        printf("%-22s %6lu %6lu %9lu %9lu %9lu %9.0f", b.name, r.starts, r.bytes,
+            r.busUs[0], r.busUs[1], r.busUs[2], ns);
+
+        std::map<std::string, Result>::iterator base = baseline.find(b.name);
+        if (base == baseline.end())
+        {
+            if (baselineFile) printf("  (not in baseline)");
+        }
+        else if (regressed(r, base->second))
+        {
+            const Result &o = base->second;
+            printf("  REGRESSION, was %lu %lu %lu %lu %lu", o.starts, o.bytes,
+                o.busUs[0], o.busUs[1], o.busUs[2]);
+            nRegressed++;
+        }
+        printf("\n");
+    }
+
+    if (writeFile && !writeBaseline(writeFile, results))
+    {
+        fprintf(stderr, "rtcbench: cannot write %s\n", writeFile);
+        return 2;
+    }
+    if (nRegressed)
+    {
+        printf("%d function(s) regressed\n", nRegressed);
+        return 1;
+    }
+    return 0;
+}
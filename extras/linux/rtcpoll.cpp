@@ -0,0 +1,356 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// rtcpoll: read the time from many MCP79412 RTCs on a Linux host.
+//
+// Each device is given as N (the RTC on /dev/i2c-N) or N:MUX:CH (the
+// RTC on channel CH of the TCA9548A at address MUX on /dev/i2c-N).
+// The devices on one bus are read one after the other by a single
+// task, so a bus is only ever used by one thread; separate buses are
+// read in parallel by a pool of worker threads, started once and
+// woken for each sweep. Each worker has its own queue of bus tasks
+// and, when that is empty, takes tasks from the back of another
+// worker's queue, so a slow bus does not hold up the rest of the
+// sweep.
+//
+// usage: rtcpoll [-s sweeps] [-i interval_ms] [-j workers] [-v] device...
+//
+// After the last sweep, the number of reads, errors and the minimum,
+// average and maximum read time for each device are printed.
+
+#include <MCP79412RTC.h>
+#include "LinuxI2CBus.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef std::chrono::steady_clock Clock;
+
+// One RTC, and the results of reading it.
+struct Device
+{
+    const char *spec;               // as given on the command line
+    MCP79412RTC *rtc;
+    MCP79412MuxBus *mux;            // 0 if not behind a multiplexer
+    time_t lastTime;                // time read in the last sweep
+    bool lastOk;                    // whether the last read succeeded
+    unsigned long reads;
+    unsigned long errors;
+    double minUs, maxUs, sumUs;     // read times, microseconds
+};
+
+// All the devices on one /dev/i2c-N. This is the unit of work.
+struct Bus
+{
+    LinuxI2CBus *i2c;
+    std::vector<Device*> devices;
+};
+
+// A queue of bus tasks owned by one worker.
+struct WorkQueue
+{
+    std::mutex lock;
+    std::deque<Bus*> tasks;
+};
+
+static bool verbose = false;
+
+// Read each RTC on the bus once, recording the time taken.
+static void pollBus(Bus *bus)
+{
+    for (size_t i=0; i<bus->devices.size(); i++)
+    {
+        Device *d = bus->devices[i];
+        tmElements_t tm;
+        Clock::time_point t0 = Clock::now();
+        bool ok = bus->i2c->isOpen() && d->rtc->read(tm);
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+
+        d->reads++;
+        d->lastOk = ok;
+        if (!ok)
+        {
+            d->errors++;
+            continue;
+        }
+        d->lastTime = makeTime(tm);
+        if (us < d->minUs) d->minUs = us;
+        if (us > d->maxUs) d->maxUs = us;
+        d->sumUs += us;
+    }
+}
+
+// Take the next task for worker n: from the front of its own queue,
+// otherwise from the back of another worker's queue. Returns 0 when
+// all the queues are empty.
+static Bus *nextTask(std::vector<WorkQueue> &queues, size_t n)
+{
+    for (size_t i=0; i<queues.size(); i++)
+    {
+        WorkQueue &q = queues[(n + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty()) continue;
+        Bus *b;
+        if (i == 0)
+        {
+            b = q.tasks.front();
+            q.tasks.pop_front();
+        }
+        else
+        {
+            b = q.tasks.back();
+            q.tasks.pop_back();
+        }
+        return b;
+    }
+    return 0;
+}
+
+// Run the tasks in the queues until they are all done, as worker n.
+static void runTasks(std::vector<WorkQueue> &queues, size_t n)
+{
+    Bus *b;
+    while ( (b = nextTask(queues, n)) ) pollBus(b);
+}
+
+// The worker threads. The calling thread is worker 0, and the others
+// are started once and wait between sweeps, so a sweep costs a
+// wake-up per worker rather than a thread start and join.
+class Pool
+{
+    public:
+        Pool(size_t nWorkers);
+        ~Pool();
+        void sweep(std::vector<Bus*> &buses);
+
+    private:
+        void worker(size_t n);
+
+        std::vector<WorkQueue> m_queues;
+        std::vector<std::thread> m_threads;
+        std::mutex m_lock;
+        std::condition_variable m_start;    // a sweep has been queued, or the pool is stopping
+        std::condition_variable m_finish;   // a worker has finished the sweep
+        unsigned long m_generation;         // sweeps queued so far
+        size_t m_running;                   // workers yet to finish the sweep
+        bool m_stop;
+};
+
+Pool::Pool(size_t nWorkers)
+    : m_queues(nWorkers), m_generation(0), m_running(0), m_stop(false)
+{
+    for (size_t i=1; i<nWorkers; i++)
+        m_threads.push_back(std::thread(&Pool::worker, this, i));
+}
+
+Pool::~Pool()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (size_t i=0; i<m_threads.size(); i++)
+        m_threads[i].join();
+}
+
+// Poll every bus once.
+void Pool::sweep(std::vector<Bus*> &buses)
+{
+    for (size_t i=0; i<buses.size(); i++)
+    {
+        WorkQueue &q = m_queues[i % m_queues.size()];
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.tasks.push_back(buses[i]);
+    }
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_generation++;
+        m_running = m_threads.size();
+    }
+    m_start.notify_all();
+    runTasks(m_queues, 0);
+
+    std::unique_lock<std::mutex> guard(m_lock);
+    while (m_running > 0) m_finish.wait(guard);
+}
+
+void Pool::worker(size_t n)
+{
+    unsigned long done = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(m_lock);
+            while (!m_stop && m_generation == done) m_start.wait(guard);
+            if (m_stop) return;
+            done = m_generation;
+        }
+        runTasks(m_queues, n);
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_running--;
+        }
+        m_finish.notify_one();
+    }
+}
+
+// Parse N or N:MUX:CH. Returns false if the spec is not valid.
+static bool parseSpec(const char *spec, int *busNumber, int *muxAddr, int *channel)
+{
+    char *end;
+
+    *muxAddr = -1;
+    *channel = -1;
+    *busNumber = strtol(spec, &end, 0);
+    if (end == spec || *busNumber < 0) return false;
+    if (*end == '\0') return true;
+    if (*end != ':') return false;
+    spec = end + 1;
+    *muxAddr = strtol(spec, &end, 0);
+    if (end == spec || *end != ':' || *muxAddr < 0x70 || *muxAddr > 0x77) return false;
+    spec = end + 1;
+    *channel = strtol(spec, &end, 0);
+    return end != spec && *end == '\0' && *channel >= 0 && *channel <= 7;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: rtcpoll [-s sweeps] [-i interval_ms] [-j workers] [-v] device...\n"
+        "  device is N (/dev/i2c-N) or N:MUX:CH (TCA9548A at MUX, channel CH)\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    int sweeps = 1;
+    int intervalMs = 1000;
+    int nWorkers = 0;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "s:i:j:v")) != -1 )
+    {
+        switch (opt)
+        {
+            case 's': sweeps = atoi(optarg); break;
+            case 'i': intervalMs = atoi(optarg); break;
+            case 'j': nWorkers = atoi(optarg); break;
+            case 'v': verbose = true; break;
+            default: usage();
+        }
+    }
+    if (optind >= argc || sweeps < 1 || intervalMs < 0) usage();
+
+    // group the devices by bus
+    std::map<int, Bus*> busMap;
+    std::vector<Bus*> buses;
+    std::vector<Device*> devices;
+    for (int i=optind; i<argc; i++)
+    {
+        int busNumber, muxAddr, channel;
+        if (!parseSpec(argv[i], &busNumber, &muxAddr, &channel))
+        {
+            fprintf(stderr, "rtcpoll: bad device '%s'\n", argv[i]);
+            usage();
+        }
+        Bus *&b = busMap[busNumber];
+        if (!b)
+        {
+            b = new Bus;
+            b->i2c = new LinuxI2CBus(busNumber);
+            b->i2c->begin();
+            if (!b->i2c->isOpen())
+                fprintf(stderr, "rtcpoll: cannot open /dev/i2c-%d\n", busNumber);
+            buses.push_back(b);
+        }
+        Device *d = new Device();
+        d->spec = argv[i];
+        d->minUs = 1e30;
+        if (muxAddr >= 0)
+        {
+            d->mux = new MCP79412MuxBus(*b->i2c, muxAddr, channel);
+            d->rtc = new MCP79412RTC(*d->mux);
+        }
+        else
+        {
+            d->rtc = new MCP79412RTC(*b->i2c);
+        }
+        b->devices.push_back(d);
+        devices.push_back(d);
+    }
+
+    if (nWorkers < 1)
+    {
+        nWorkers = std::thread::hardware_concurrency();
+        if (nWorkers < 1) nWorkers = 1;
+    }
+    if (nWorkers > (int)buses.size()) nWorkers = buses.size();
+
+    Pool pool(nWorkers);
+    double sweepMin = 1e30, sweepMax = 0, sweepSum = 0;
+    for (int s=0; s<sweeps; s++)
+    {
+        Clock::time_point t0 = Clock::now();
+        pool.sweep(buses);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        if (ms < sweepMin) sweepMin = ms;
+        if (ms > sweepMax) sweepMax = ms;
+        sweepSum += ms;
+
+        if (verbose)
+        {
+            printf("sweep %d: %.2f ms\n", s + 1, ms);
+            for (size_t i=0; i<devices.size(); i++)
+            {
+                Device *d = devices[i];
+                if (d->lastOk)
+                {
+                    tmElements_t tm;
+                    breakTime(d->lastTime, tm);
+                    printf("  %-12s %04d-%02d-%02d %02d:%02d:%02d\n", d->spec,
+                        tmYearToCalendar(tm.Year), tm.Month, tm.Day,
+                        tm.Hour, tm.Minute, tm.Second);
+                }
+                else
+                {
+                    printf("  %-12s error\n", d->spec);
+                }
+            }
+        }
+        if (s < sweeps - 1 && intervalMs > 0)
+        {
+            Clock::time_point next = t0 + std::chrono::milliseconds(intervalMs);
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    printf("%d sweep(s), %d device(s), %d bus(es), %d worker(s)\n",
+        sweeps, (int)devices.size(), (int)buses.size(), nWorkers);
+    printf("sweep time ms: min %.2f avg %.2f max %.2f\n",
+        sweepMin, sweepSum / sweeps, sweepMax);
+    printf("%-12s %8s %8s %10s %10s %10s\n", "device", "reads", "errors", "min us", "avg us", "max us");
+    int failed = 0;
+    for (size_t i=0; i<devices.size(); i++)
+    {
+        Device *d = devices[i];
+        unsigned long good = d->reads - d->errors;
+        if (good)
+            printf("%-12s %8lu %8lu %10.0f %10.0f %10.0f\n", d->spec, d->reads, d->errors,
+                d->minUs, d->sumUs / good, d->maxUs);
+        else
+            printf("%-12s %8lu %8lu %10s %10s %10s\n", d->spec, d->reads, d->errors, "-", "-", "-");
+        if (d->errors) failed++;
+    }
+    return failed ? 1 : 0;
+}
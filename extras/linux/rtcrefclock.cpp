@@ -0,0 +1,181 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// rtcrefclock: feed the time of an MCP79412 to chronyd or ntpd as a
+// reference clock, through their SHM driver, so that the RTC can hold
+// the system clock when the network time servers cannot be reached.
+//
+// At each seconds edge of the RTC (see RtcEdge.h), the RTC time and
+// the system time at the edge are written to the SysV shared-memory
+// segment of the given SHM unit (key 0x4e545030 + unit), as a sample
+// for the time server to read. The segment is created if the time
+// server has not already done so, readable only by root for units 0
+// and 1, as ntpd expects, and by all for the others.
+//
+// usage: rtcrefclock [-g chip:line] [-r] [-u unit] [-v] bus
+//   -g  GPIO line wired to the MFP, e.g. /dev/gpiochip0:17
+//   -r  the seconds change on the rising edge of the MFP, not falling
+//   -u  SHM unit, default 2
+//   -v  print each sample
+
+#include "RtcEdge.h"
+#include "LinuxI2CBus.h"
+#include <atomic>
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#define NTP_SHM_KEY 0x4e545030      // "NTP0", plus the unit
+
+// The segment, as defined by ntpd's refclock_shm.c and read by chronyd
+struct ntpShm_t {
+    int mode;                       // 1: count is changed around each update
+    volatile int count;
+    time_t clockTimeStampSec;       // the reference (RTC) time
+    int clockTimeStampUSec;
+    time_t receiveTimeStampSec;     // the system time at the same moment
+    int receiveTimeStampUSec;
+    int leap;
+    int precision;                  // log2 of the sample's precision in s
+    int nsamples;
+    volatile int valid;             // set once the sample is complete
+    unsigned clockTimeStampNSec;
+    unsigned receiveTimeStampNSec;
+    int dummy[8];
+};
+
+static volatile sig_atomic_t stopping;
+
+static void onSignal(int)
+{
+    stopping = 1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: rtcrefclock [-g chip:line] [-r] [-u unit] [-v] bus\n");
+    exit(2);
+}
+
+// Attach the segment for the unit, creating it if need be.
+static ntpShm_t *attachShm(int unit)
+{
+    int id = shmget(NTP_SHM_KEY + unit, sizeof(ntpShm_t), unit < 2 ? 0600 | IPC_CREAT : 0666 | IPC_CREAT);
+    if (id < 0) return 0;
+    void *p = shmat(id, 0, 0);
+    return p == (void*)-1 ? 0 : (ntpShm_t*)p;
+}
+
+// Write a sample, with the mode 1 protocol: the reader takes the
+// sample only if valid is set and count is the same before and after.
+static void writeSample(ntpShm_t *shm, const rtcEdge_t &e)
+{
+    int64_t ns = e.realNs;
+    int precision = (int)ceil(log2((e.uncertaintyNs < 1000 ? 1000 : e.uncertaintyNs) / 1e9));
+
+    shm->valid = 0;
+    shm->count++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    shm->mode = 1;
+    shm->clockTimeStampSec = e.rtcTime;
+    shm->clockTimeStampUSec = 0;
+    shm->clockTimeStampNSec = 0;
+    shm->receiveTimeStampSec = ns / 1000000000LL;
+    shm->receiveTimeStampUSec = ns % 1000000000LL / 1000;
+    shm->receiveTimeStampNSec = ns % 1000000000LL;
+    shm->leap = 0;
+    shm->precision = precision;
+    shm->nsamples = 3;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    shm->count++;
+    shm->valid = 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *gpio = 0;
+    bool rising = false;
+    int unit = 2;
+    bool verbose = false;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "g:ru:v")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'g': gpio = optarg; break;
+            case 'r': rising = true; break;
+            case 'u': unit = atoi(optarg); break;
+            case 'v': verbose = true; break;
+            default: usage();
+        }
+    }
+    if (optind != argc - 1 || unit < 0 || unit > 255) usage();
+
+    LinuxI2CBus i2c(atoi(argv[optind]));
+    i2c.begin();
+    if (!i2c.isOpen())
+    {
+        fprintf(stderr, "rtcrefclock: cannot open /dev/i2c-%s\n", argv[optind]);
+        return 2;
+    }
+    MCP79412RTC rtc(i2c);
+    rtc.setRetry(2, 200);
+    RtcEdge edge(rtc);
+    if (gpio)
+    {
+        char chip[64];
+        const char *colon = strrchr(gpio, ':');
+        if (!colon || colon - gpio >= (int)sizeof(chip)) usage();
+        memcpy(chip, gpio, colon - gpio);
+        chip[colon - gpio] = 0;
+        if (!edge.openGpio(chip, atoi(colon + 1), rising))
+        {
+            fprintf(stderr, "rtcrefclock: cannot use GPIO %s\n", gpio);
+            return 2;
+        }
+    }
+
+    ntpShm_t *shm = attachShm(unit);
+    if (!shm)
+    {
+        perror("rtcrefclock: cannot attach the SHM segment");
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    unsigned long errors = 0;
+    while (!stopping)
+    {
+        rtcEdge_t e;
+        // a stopped RTC has no edges; the time server then sees no
+        // new samples, and stops using the RTC
+        if (edge.wait(e))
+        {
+            writeSample(shm, e);
+            if (verbose)
+            {
+                printf("RTC %lld, RTC - system %+.6f s, edge uncertainty %u us\n", (long long)e.rtcTime,
+                    ((int64_t)e.rtcTime * 1000000000LL - e.realNs) / 1e9, e.uncertaintyNs / 1000);
+                fflush(stdout);
+            }
+        }
+        else if (!stopping)
+        {
+            if (++errors == 1 || errors % 60 == 0)
+                fprintf(stderr, "rtcrefclock: no time from the RTC (status %d), %lu errors\n", rtc.lastStatus(), errors);
+            usleep(100000);     // do not spin on a missing RTC
+        }
+    }
+    shm->valid = 0;
+    shmdt(shm);
+    return 0;
+}
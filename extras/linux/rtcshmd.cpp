@@ -0,0 +1,193 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// rtcshmd: publish the time of an MCP79412 to other processes through
+// shared memory (see RtcShm.h), so that they can have the RTC time
+// without each opening the bus.
+//
+// The RTC on /dev/i2c-N is read once a second, at its seconds edge
+// (see RtcEdge.h), found from the MFP's 1Hz square wave on a GPIO
+// line if one is given with -g, else by reading the RTC. The RTC time
+// and the host's clocks at the edge are written to the shared-memory
+// page, name /mcp79412rtc unless given with -n. A failed read or a
+// missed edge is counted, and the page is left with the last good
+// time; on SIGINT or SIGTERM the page is marked not valid. The daemon
+// holds an exclusive flock() on the page while it runs, so a second
+// daemon for the same name exits at once.
+//
+// With -p, rtcshmd reads the page instead and prints what it holds,
+// as a check on a running daemon.
+//
+// usage: rtcshmd [-g chip:line] [-r] [-n name] bus
+//        rtcshmd -p [-n name]
+//   -g  GPIO line wired to the MFP, e.g. /dev/gpiochip0:17
+//   -r  the seconds change on the rising edge of the MFP, not falling
+
+#include "RtcEdge.h"
+#include "RtcShm.h"
+#include "LinuxI2CBus.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+static volatile sig_atomic_t stopping;
+
+static void onSignal(int)
+{
+    stopping = 1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: rtcshmd [-g chip:line] [-r] [-n name] bus\n"
+        "       rtcshmd -p [-n name]\n");
+    exit(2);
+}
+
+// Print the page, with the RTC time now.
+static int printShm(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "rtcshmd: no shared memory %s\n", name);
+        return 2;
+    }
+    const rtcShm_t *shm = (const rtcShm_t*)mmap(0, sizeof(rtcShm_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    rtcShmSample_t s;
+    if (shm == MAP_FAILED || !rtcShmRead(shm, s))
+    {
+        fprintf(stderr, "rtcshmd: %s is not an RTC time page\n", name);
+        return 2;
+    }
+    printf("valid %d, source %s, status %d, %lu updates, %lu errors\n", s.valid,
+        s.source == RTC_SHM_GPIO ? "gpio" : "poll", s.status,
+        (unsigned long)s.updates, (unsigned long)s.errors);
+    if (s.valid)
+    {
+        int64_t now = rtcShmNow(s);
+        printf("RTC time %lld.%09lld, RTC - system %+.6f s, edge uncertainty %u ns\n",
+            (long long)(now / 1000000000LL), (long long)(now % 1000000000LL),
+            (s.rtcTime * 1000000000LL - s.realNs) / 1e9, (unsigned)s.uncertaintyNs);
+    }
+    return s.valid ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = RTC_SHM_NAME;
+    const char *gpio = 0;
+    bool rising = false;
+    bool print = false;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "g:rn:p")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'g': gpio = optarg; break;
+            case 'r': rising = true; break;
+            case 'n': name = optarg; break;
+            case 'p': print = true; break;
+            default: usage();
+        }
+    }
+    if (print)
+    {
+        if (optind != argc) usage();
+        return printShm(name);
+    }
+    if (optind != argc - 1) usage();
+
+    LinuxI2CBus i2c(atoi(argv[optind]));
+    i2c.begin();
+    if (!i2c.isOpen())
+    {
+        fprintf(stderr, "rtcshmd: cannot open /dev/i2c-%s\n", argv[optind]);
+        return 2;
+    }
+    MCP79412RTC rtc(i2c);
+    rtc.setRetry(2, 200);
+    RtcEdge edge(rtc);
+    if (gpio)
+    {
+        char chip[64];
+        const char *colon = strrchr(gpio, ':');
+        if (!colon || colon - gpio >= (int)sizeof(chip)) usage();
+        memcpy(chip, gpio, colon - gpio);
+        chip[colon - gpio] = 0;
+        if (!edge.openGpio(chip, atoi(colon + 1), rising))
+        {
+            fprintf(stderr, "rtcshmd: cannot use GPIO %s\n", gpio);
+            return 2;
+        }
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "rtcshmd: cannot create shared memory %s\n", name);
+        return 2;
+    }
+    // the lock is held until exit, through fd, so there is only ever one writer
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        fprintf(stderr, "rtcshmd: %s is in use by another rtcshmd\n", name);
+        return 2;
+    }
+    if (ftruncate(fd, sizeof(rtcShm_t)) != 0)
+    {
+        fprintf(stderr, "rtcshmd: cannot create shared memory %s\n", name);
+        return 2;
+    }
+    rtcShm_t *shm = (rtcShm_t*)mmap(0, sizeof(rtcShm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shm == MAP_FAILED)
+    {
+        fprintf(stderr, "rtcshmd: cannot map shared memory %s\n", name);
+        return 2;
+    }
+
+    // a daemon that died while writing leaves seq odd; make it even
+    // again, so that readers are not locked out by it
+    rtcShmReset(shm);
+    rtcShmSample_t s;
+    memset(&s, 0, sizeof(s));
+    s.source = edge.usingGpio() ? RTC_SHM_GPIO : RTC_SHM_POLL;
+    rtcShmWrite(shm, s);
+    shm->version = RTC_SHM_VERSION;
+    shm->magic = RTC_SHM_MAGIC;
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    while (!stopping)
+    {
+        rtcEdge_t e;
+        if (edge.wait(e))
+        {
+            s.rtcTime = e.rtcTime;
+            s.monoNs = e.monoNs;
+            s.realNs = e.realNs;
+            s.uncertaintyNs = e.uncertaintyNs;
+            s.updates++;
+            s.valid = 1;
+        }
+        else
+        {
+            s.errors++;
+            if (!stopping) usleep(100000);      // do not spin on a missing RTC
+        }
+        s.status = rtc.lastStatus();
+        rtcShmWrite(shm, s);
+    }
+    s.valid = 0;
+    rtcShmWrite(shm, s);
+    return 0;
+}
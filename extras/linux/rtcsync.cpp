@@ -0,0 +1,175 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// rtcsync: keep the Linux system clock and an MCP79412 in step, like
+// hwclock, but aligned to the RTC's seconds edge (see RtcEdge.h and
+// RtcClock.h) rather than to the second.
+//
+//   rtcsync bus             print the RTC - system offset
+//   rtcsync -s bus          step the system clock to the RTC, at boot
+//   rtcsync -a bus          slew the system clock to the RTC, or step
+//                           it if the offset is more than the -m limit
+//   rtcsync -w interval bus every interval seconds, write the system
+//                           time to the RTC if they differ by more
+//                           than the -t threshold, and the system
+//                           clock is synchronized (unless -f)
+//
+// usage: rtcsync [-g chip:line] [-r] [-s | -a | -w interval] [-m max_slew_ms]
+//                [-t threshold_ms] [-f] bus
+
+#include "RtcClock.h"
+#include "LinuxI2CBus.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t stopping;
+
+static void onSignal(int)
+{
+    stopping = 1;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: rtcsync [-g chip:line] [-r] [-s | -a | -w interval] [-m max_slew_ms]\n"
+        "               [-t threshold_ms] [-f] bus\n");
+    exit(2);
+}
+
+// Wait for an edge, with a few tries.
+static bool waitEdge(RtcEdge &edge, MCP79412RTC &rtc, rtcEdge_t &e)
+{
+    for (int tries=0; tries<3; tries++)
+        if (edge.wait(e)) return true;
+    bool running = rtc.isRunning();
+    if (rtc.lastStatus() == RTC_OK && !running)
+        fprintf(stderr, "rtcsync: the RTC is stopped, its time is not valid\n");
+    else
+        fprintf(stderr, "rtcsync: cannot read the RTC (status %d)\n", rtc.lastStatus());
+    return false;
+}
+
+// Write the system time to the RTC whenever they drift apart.
+static int writeBack(RtcEdge &edge, MCP79412RTC &rtc, int interval, double thresholdMs, bool force)
+{
+    int64_t leadNs = 0;
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    while (!stopping)
+    {
+        rtcEdge_t e;
+        if (waitEdge(edge, rtc, e))
+        {
+            double offsetMs = rtcOffsetNs(e) / 1e6;
+            if (offsetMs > thresholdMs || offsetMs < -thresholdMs)
+            {
+                if (!force && !systemClockSynced())
+                {
+                    printf("RTC - system %+.3f ms, system clock not synchronized, not written\n", offsetMs);
+                }
+                else
+                {
+                    int64_t durationNs;
+                    rtcStatus_t status = writeRtcFromSystem(rtc, leadNs, &durationNs);
+                    if (status == RTC_OK)
+                    {
+                        leadNs = durationNs;
+                        printf("RTC - system %+.3f ms, RTC written\n", offsetMs);
+                    }
+                    else
+                    {
+                        fprintf(stderr, "rtcsync: cannot write the RTC (status %d)\n", status);
+                    }
+                }
+                fflush(stdout);
+            }
+        }
+        for (int i=0; i<interval && !stopping; i++) sleep(1);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *gpio = 0;
+    bool rising = false;
+    char mode = 0;
+    int interval = 0;
+    double maxSlewMs = 500;
+    double thresholdMs = 5;
+    bool force = false;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "g:rsaw:m:t:f")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'g': gpio = optarg; break;
+            case 'r': rising = true; break;
+            case 's': case 'a': mode = opt; break;
+            case 'w': mode = opt; interval = atoi(optarg); break;
+            case 'm': maxSlewMs = atof(optarg); break;
+            case 't': thresholdMs = atof(optarg); break;
+            case 'f': force = true; break;
+            default: usage();
+        }
+    }
+    if (optind != argc - 1 || (mode == 'w' && interval < 1) || thresholdMs < 0) usage();
+
+    LinuxI2CBus i2c(atoi(argv[optind]));
+    i2c.begin();
+    if (!i2c.isOpen())
+    {
+        fprintf(stderr, "rtcsync: cannot open /dev/i2c-%s\n", argv[optind]);
+        return 2;
+    }
+    MCP79412RTC rtc(i2c);
+    rtc.setRetry(2, 200);
+    RtcEdge edge(rtc);
+    if (gpio)
+    {
+        char chip[64];
+        const char *colon = strrchr(gpio, ':');
+        if (!colon || colon - gpio >= (int)sizeof(chip)) usage();
+        memcpy(chip, gpio, colon - gpio);
+        chip[colon - gpio] = 0;
+        if (!edge.openGpio(chip, atoi(colon + 1), rising))
+        {
+            fprintf(stderr, "rtcsync: cannot use GPIO %s\n", gpio);
+            return 2;
+        }
+    }
+
+    if (mode == 'w') return writeBack(edge, rtc, interval, thresholdMs, force);
+
+    rtcEdge_t e;
+    if (!waitEdge(edge, rtc, e)) return 1;
+    int64_t offsetNs = rtcOffsetNs(e);
+    printf("RTC - system %+.6f s, edge uncertainty %u us\n", offsetNs / 1e9, e.uncertaintyNs / 1000);
+    bool step = (mode == 's') || (mode == 'a' && (offsetNs > maxSlewMs * 1e6 || offsetNs < -maxSlewMs * 1e6));
+    if (step)
+    {
+        if (!stepSystemClock(e))
+        {
+            perror("rtcsync: cannot set the system clock");
+            return 1;
+        }
+        printf("system clock stepped\n");
+    }
+    else if (mode == 'a')
+    {
+        if (!slewSystemClock(offsetNs))
+        {
+            perror("rtcsync: cannot adjust the system clock");
+            return 1;
+        }
+        printf("system clock slewing\n");
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// rtctrace: print an I2C bus trace recorded by MCP79412RecordBus.
+//
+// Each transaction is printed with its start time, direction,
+// address, status, data and duration, followed by a summary for each
+// I2C address: transactions, NACKs, bytes written and read, and the
+// total time the transactions took.
+//
+// usage: rtctrace [-s] file
+//   -s  print the summary only
+
+#include <MCP79412Trace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+// Totals for one I2C address.
+struct AddrStats
+{
+    unsigned long transactions;
+    unsigned long nacks;
+    unsigned long bytesOut;
+    unsigned long bytesIn;
+    unsigned long micros;
+};
+
+static const char *statusName(const traceRecord_t &rec)
+{
+    static const char * const writeStatus[] = {
+        "ACK", "too long", "addr NACK", "data NACK", "error", "timeout", "status 6", "status 7" };
+
+    if (rec.read) return rec.status ? "short" : "ACK";
+    return writeStatus[rec.status];
+}
+
+static bool readFile(const char *file, std::vector<uint8_t> &buf)
+{
+    FILE *f = fopen(file, "rb");
+    uint8_t chunk[4096];
+    size_t n;
+
+    if (!f) return false;
+    while ( (n = fread(chunk, 1, sizeof(chunk), f)) > 0 )
+        buf.insert(buf.end(), chunk, chunk + n);
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool summaryOnly = false;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "s")) != -1 )
+    {
+        if (opt == 's')
+            summaryOnly = true;
+        else
+        {
+            fprintf(stderr, "usage: rtctrace [-s] file\n");
+            return 2;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "usage: rtctrace [-s] file\n");
+        return 2;
+    }
+
+    std::vector<uint8_t> buf;
+    if (!readFile(argv[optind], buf))
+    {
+        fprintf(stderr, "rtctrace: cannot read %s\n", argv[optind]);
+        return 2;
+    }
+    MCP79412TraceReader reader(buf.data(), buf.size());
+    if (!reader.valid())
+    {
+        fprintf(stderr, "rtctrace: %s is not a trace\n", argv[optind]);
+        return 2;
+    }
+
+    AddrStats stats[128] = {};
+    traceRecord_t rec;
+    uint32_t end = 0;
+    while (reader.next(rec))
+    {
+        AddrStats &s = stats[rec.addr & 0x7F];
+        s.transactions++;
+        if (rec.status) s.nacks++;
+        if (rec.read) s.bytesIn += rec.nData; else s.bytesOut += rec.nData;
+        s.micros += rec.duration;
+        end = rec.start + rec.duration;
+
+        if (summaryOnly) continue;
+        printf("%12.3f ms  %c 0x%02X %-9s", rec.start / 1000.0, rec.read ? 'R' : 'W',
+            rec.addr, statusName(rec));
+        if (rec.read) printf(" %2u/%-2u", rec.nData, rec.requested);
+        else printf(" %2u   ", rec.nData);
+        for (uint8_t i=0; i<rec.nData; i++) printf(" %02X", rec.data[i]);
+        if (rec.truncated) printf(" ...");
+        printf("  %u us\n", rec.duration);
+    }
+    if (!reader.atEnd())
+        fprintf(stderr, "rtctrace: the trace ends with an incomplete record\n");
+
+    printf("%lu transaction(s) in %.3f ms\n", (unsigned long)reader.index(), end / 1000.0);
+    printf("addr  transactions   nacks  bytes out   bytes in   bus us\n");
+    for (int a=0; a<128; a++)
+    {
+        AddrStats &s = stats[a];
+        if (!s.transactions) continue;
+        printf("0x%02X  %12lu %7lu %10lu %10lu %8lu\n", a, s.transactions, s.nacks,
+            s.bytesOut, s.bytesIn, s.micros);
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// rtcvcd: convert an I2C bus trace (see MCP79412Trace.h) into an
+// SDA/SCL timeline in VCD format, for viewing in PulseView (sigrok),
+// GTKWave and the like, where the I2C protocol decoder can be used
+// on it as on a capture from a logic analyzer.
+//
+// Each transaction is laid out bit by bit at the given SCL frequency:
+// START, the address byte, the data bytes each with its ACK bit, and
+// STOP. SCL is low for half the period and high for half, and SDA
+// changes in the middle of the low half. A NACKed address ends the
+// transaction; on a read, the master NACKs the last byte. A slave
+// clock-stretching time can be given, which holds SCL low after the
+// ACK bit of every byte. Between transactions the bus is idle for the
+// given gap, or for the recorded time between them if longer (-r).
+//
+// A third signal, busy, is high from START to STOP, to measure how
+// long each transaction holds the bus. A summary of the modeled bus
+// time is printed.
+//
+// usage: rtcvcd [-f scl_hz] [-s stretch_us] [-g gap_us] [-r] trace vcd
+
+#include <MCP79412Trace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+// Writes value changes to a VCD file, in time order.
+class VcdWriter
+{
+    public:
+        enum { SCL, SDA, BUSY, N_SIGNALS };
+
+        VcdWriter(FILE *f) : m_f(f), m_time(0)
+        {
+            static const char * const names[N_SIGNALS] = { "SCL", "SDA", "busy" };
+            fprintf(f, "$timescale 1 ns $end\n$scope module i2c $end\n");
+            for (int i=0; i<N_SIGNALS; i++)
+                fprintf(f, "$var wire 1 %c %s $end\n", '!' + i, names[i]);
+            fprintf(f, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+            m_value[SCL] = 1;
+            m_value[SDA] = 1;
+            m_value[BUSY] = 0;
+            for (int i=0; i<N_SIGNALS; i++) fprintf(f, "%d%c\n", m_value[i], '!' + i);
+            fprintf(f, "$end\n");
+        }
+
+        // Set a signal at time t (ns), which must not be before the
+        // last change.
+        void set(uint64_t t, int signal, int value)
+        {
+            if (m_value[signal] == value) return;
+            if (t != m_time) fprintf(m_f, "#%llu\n", (unsigned long long)t);
+            m_time = t;
+            m_value[signal] = value;
+            fprintf(m_f, "%d%c\n", value, '!' + signal);
+        }
+
+        void finish(uint64_t t) { fprintf(m_f, "#%llu\n", (unsigned long long)t); }
+
+    private:
+        FILE *m_f;
+        uint64_t m_time;
+        int m_value[N_SIGNALS];
+};
+
+// Lays out transactions on the bus, from time t (ns).
+class Timeline
+{
+    public:
+        Timeline(VcdWriter &vcd, uint32_t sclHz, uint32_t stretchNs)
+            : t(0), m_vcd(vcd), m_half(500000000ULL / sclHz), m_stretch(stretchNs) {}
+
+        // Lay out one transaction. Returns its duration in ns.
+        uint64_t transaction(const traceRecord_t &rec)
+        {
+            uint64_t t0 = t;
+            bool addrAck = !(rec.read ? (rec.nData == 0 && rec.requested > 0) : rec.status == 2);
+
+            start();
+            byte((rec.addr << 1) | (rec.read ? 1 : 0), !addrAck);
+            if (addrAck)
+            {
+                for (uint8_t i=0; i<rec.nData; i++)
+                {
+                    bool nack;
+                    if (rec.read)
+                        nack = (i == rec.nData - 1);    // master NACKs the last byte
+                    else
+                        nack = (rec.status == 3 && i == rec.nData - 1);
+                    byte(rec.data[i], nack);
+                }
+            }
+            stop();
+            return t - t0;
+        }
+
+        void idle(uint64_t ns) { t += ns; }
+
+        uint64_t t;             // current time, ns
+
+    private:
+        // SDA falls while SCL is high, then SCL falls.
+        void start()
+        {
+            m_vcd.set(t, VcdWriter::BUSY, 1);
+            m_vcd.set(t, VcdWriter::SDA, 0);
+            t += m_half;
+            m_vcd.set(t, VcdWriter::SCL, 0);
+        }
+
+        // One clock: SDA set in the middle of SCL low, then SCL high.
+        void bit(int value)
+        {
+            t += m_half / 2;
+            m_vcd.set(t, VcdWriter::SDA, value);
+            t += m_half - m_half / 2;
+            m_vcd.set(t, VcdWriter::SCL, 1);
+            t += m_half;
+            m_vcd.set(t, VcdWriter::SCL, 0);
+        }
+
+        // Eight data bits, most significant first, then the ACK bit,
+        // then any clock stretching by the slave.
+        void byte(uint8_t value, bool nack)
+        {
+            for (int i=7; i>=0; i--) bit((value >> i) & 1);
+            bit(nack ? 1 : 0);
+            t += m_stretch;
+        }
+
+        // SDA low while SCL is low, SCL rises, then SDA rises.
+        void stop()
+        {
+            t += m_half / 2;
+            m_vcd.set(t, VcdWriter::SDA, 0);
+            t += m_half - m_half / 2;
+            m_vcd.set(t, VcdWriter::SCL, 1);
+            t += m_half;
+            m_vcd.set(t, VcdWriter::SDA, 1);
+            m_vcd.set(t, VcdWriter::BUSY, 0);
+        }
+
+        VcdWriter &m_vcd;
+        uint64_t m_half;        // half an SCL period, ns
+        uint64_t m_stretch;     // clock stretching after each byte, ns
+};
+
+static void usage()
+{
+    fprintf(stderr, "usage: rtcvcd [-f scl_hz] [-s stretch_us] [-g gap_us] [-r] trace vcd\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sclHz = 100000;
+    double stretchUs = 0;
+    double gapUs = -1;
+    bool recordedGaps = false;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "f:s:g:r")) != -1 )
+    {
+        switch (opt)
+        {
+            case 'f': sclHz = strtoul(optarg, 0, 0); break;
+            case 's': stretchUs = atof(optarg); break;
+            case 'g': gapUs = atof(optarg); break;
+            case 'r': recordedGaps = true; break;
+            default: usage();
+        }
+    }
+    if (optind != argc - 2 || sclHz < 1000 || sclHz > 5000000 || stretchUs < 0) usage();
+    if (gapUs < 0) gapUs = 1e6 / sclHz;     // default gap, one SCL period
+
+    FILE *in = fopen(argv[optind], "rb");
+    if (!in)
+    {
+        fprintf(stderr, "rtcvcd: cannot read %s\n", argv[optind]);
+        return 2;
+    }
+    std::vector<uint8_t> buf;
+    uint8_t chunk[4096];
+    size_t n;
+    while ( (n = fread(chunk, 1, sizeof(chunk), in)) > 0 ) buf.insert(buf.end(), chunk, chunk + n);
+    fclose(in);
+
+    MCP79412TraceReader reader(buf.data(), buf.size());
+    if (!reader.valid())
+    {
+        fprintf(stderr, "rtcvcd: %s is not a trace\n", argv[optind]);
+        return 2;
+    }
+    FILE *out = fopen(argv[optind + 1], "w");
+    if (!out)
+    {
+        fprintf(stderr, "rtcvcd: cannot write %s\n", argv[optind + 1]);
+        return 2;
+    }
+
+    VcdWriter vcd(out);
+    Timeline line(vcd, sclHz, stretchUs * 1000);
+    traceRecord_t rec;
+    uint64_t busNs = 0, maxNs = 0;
+    uint64_t lastStart = 0;         // recorded start of the previous transaction, ns
+    uint64_t lastModeled = 0;       // modeled start of the previous transaction
+    unsigned long count = 0;
+    line.idle(gapUs * 1000);
+    while (reader.next(rec))
+    {
+        if (count > 0)
+        {
+            uint64_t gap = gapUs * 1000;
+            if (recordedGaps)
+            {
+                // keep the recorded start times, where the bus allows
+                uint64_t recorded = lastModeled + ((uint64_t)rec.start * 1000 - lastStart);
+                if (recorded > line.t + gap) gap = recorded - line.t;
+            }
+            line.idle(gap);
+        }
+        lastStart = (uint64_t)rec.start * 1000;
+        lastModeled = line.t;
+        uint64_t ns = line.transaction(rec);
+        busNs += ns;
+        if (ns > maxNs) maxNs = ns;
+        count++;
+    }
+    line.idle(gapUs * 1000);
+    vcd.finish(line.t);
+    fclose(out);
+
+    if (!reader.atEnd())
+        fprintf(stderr, "rtcvcd: the trace ends with an incomplete record\n");
+    printf("%lu transaction(s) at %lu Hz: bus busy %.1f us, longest %.1f us, timeline %.1f us\n",
+        count, (unsigned long)sclHz, busNs / 1000.0, maxNs / 1000.0, line.t / 1000.0);
+    return 0;
+}
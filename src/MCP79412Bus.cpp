@@ -0,0 +1,167 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// I2C bus interface for the MCP79412RTC driver. See MCP79412Bus.h
+// for details.
+
+#include <MCP79412Bus.h>
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
+#include "i2c.h"
+
+MCP79412I2CBus rtcI2C;
+
+void MCP79412I2CBus::begin()
+{
+    i2c.begin();
+}
+
+void MCP79412I2CBus::beginTransmission(uint8_t addr)
+{
+    i2c.beginTransmission(addr);
+}
+
+size_t MCP79412I2CBus::write(uint8_t value)
+{
+    return i2c.write(value);
+}
+
+uint8_t MCP79412I2CBus::endTransmission()
+{
+    return i2c.endTransmission();
+}
+
+uint8_t MCP79412I2CBus::requestFrom(uint8_t addr, uint8_t nBytes)
+{
+    return i2c.requestFrom(addr, nBytes);
+}
+
+int MCP79412I2CBus::read()
+{
+    return i2c.read();
+}
+
+#if defined(MCP79412RTC_SDA_PIN) && defined(MCP79412RTC_SCL_PIN)
+#include <Arduino.h>
+
+// Release a pin (open drain high) or pull it low.
+static void busPin(uint8_t pin, bool high)
+{
+    if (high) {
+        pinMode(pin, INPUT_PULLUP);
+    }
+    else {
+        digitalWrite(pin, LOW);
+        pinMode(pin, OUTPUT);
+    }
+    delayMicroseconds(5);               // half a clock at 100kHz
+}
+
+// Clock SCL until a slave holding SDA low lets it go (at most nine
+// clocks finish any byte it was sending), then send a STOP, and
+// initialize the bus again. Returns true if SDA and SCL are then high.
+bool MCP79412I2CBus::recover()
+{
+    busPin(MCP79412RTC_SDA_PIN, true);
+    busPin(MCP79412RTC_SCL_PIN, true);
+    for (uint8_t i=0; i<9 && digitalRead(MCP79412RTC_SDA_PIN) == LOW; i++) {
+        busPin(MCP79412RTC_SCL_PIN, false);
+        busPin(MCP79412RTC_SCL_PIN, true);
+    }
+    busPin(MCP79412RTC_SCL_PIN, false);    // STOP: SDA rises while SCL is high
+    busPin(MCP79412RTC_SDA_PIN, false);
+    busPin(MCP79412RTC_SCL_PIN, true);
+    busPin(MCP79412RTC_SDA_PIN, true);
+    bool idle = digitalRead(MCP79412RTC_SDA_PIN) == HIGH && digitalRead(MCP79412RTC_SCL_PIN) == HIGH;
+    i2c.begin();
+    return idle;
+}
+#endif
+#endif
+
+// Initializes the underlying bus. Since several multiplexer channels
+// normally share a bus, it is enough to call begin() for one of them.
+void MCP79412MuxBus::begin()
+{
+    m_bus.begin();
+}
+
+void MCP79412MuxBus::beginTransmission(uint8_t addr)
+{
+    m_selectStatus = select();
+    if (m_selectStatus == 0) m_bus.beginTransmission(addr);
+}
+
+size_t MCP79412MuxBus::write(uint8_t value)
+{
+    return (m_selectStatus == 0) ? m_bus.write(value) : 0;
+}
+
+// A failed transaction forgets the selection, in case the multiplexer
+// was reset and the channel is no longer connected, so the retry
+// selects it again. This includes the NACKs of EEPROM write polling,
+// each of which then costs a select.
+uint8_t MCP79412MuxBus::endTransmission()
+{
+    if (m_selectStatus != 0) return m_selectStatus;
+    uint8_t status = m_bus.endTransmission();
+    if (status != 0) m_bus.m_muxSelected = 0;
+    return status;
+}
+
+uint8_t MCP79412MuxBus::requestFrom(uint8_t addr, uint8_t nBytes)
+{
+    if (select() != 0) return 0;
+    uint8_t n = m_bus.requestFrom(addr, nBytes);
+    if (n != nBytes) m_bus.m_muxSelected = 0;
+    return n;
+}
+
+int MCP79412MuxBus::read()
+{
+    return m_bus.read();
+}
+
+// Recovers the underlying bus. The selected channel stays connected,
+// so a stuck RTC behind it is clocked too; the selection is then
+// forgotten, so the next transaction selects the channel again.
+bool MCP79412MuxBus::recover()
+{
+    bool idle = m_bus.recover();
+    m_bus.m_muxSelected = 0;
+    return idle;
+}
+
+// Select this channel, if it is not already selected, and return the
+// endTransmission() status. The selection is tracked per underlying
+// bus, so that a multiplexer on another bus does not hide the one to
+// be disconnected on this bus, and RTCs on different buses can be used
+// from different threads. If the other multiplexer's channel cannot be
+// disconnected, this channel is not connected, and the other channel
+// stays the selection, to be disconnected again next time. If this
+// channel cannot be connected, there is no selection, so the next
+// transaction selects it again.
+uint8_t MCP79412MuxBus::select()
+{
+    MCP79412MuxBus *selected = m_bus.m_muxSelected;
+    uint8_t status;
+
+    if (selected == this) return 0;
+    if (selected && selected->m_muxAddr != m_muxAddr) {
+        status = selected->muxWrite(0);     // disconnect the other multiplexer's channel
+        if (status != 0) return status;
+    }
+    status = muxWrite(1 << m_channel);
+    m_bus.m_muxSelected = (status == 0) ? this : 0;
+    return status;
+}
+
+// Write the multiplexer's control register, and return the
+// endTransmission() status.
+uint8_t MCP79412MuxBus::muxWrite(uint8_t value)
+{
+    m_bus.beginTransmission(m_muxAddr);
+    m_bus.write(value);
+    return m_bus.endTransmission();
+}
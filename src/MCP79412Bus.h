@@ -0,0 +1,113 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// I2C bus interface for the MCP79412RTC driver. Each MCP79412RTC
+// object talks to its RTC through an MCP79412Bus, which has the same
+// calls as the Wire library. The library provides:
+//
+//   MCP79412I2CBus  the platform's I2C bus (the i2c object); the
+//                   library's rtcI2C object is one of these.
+//   MCP79412MuxBus  a channel of a TCA9548A (or PCA9548A) I2C
+//                   multiplexer on another bus.
+//
+// To use an RTC on some other bus (a second I2C peripheral, a
+// software I2C, a host adapter), derive a class from MCP79412Bus.
+//
+// recover() is called by the driver when a device stops responding
+// (see MCP79412RTC::setEepromTimeout()). A bus that can drive its
+// pins directly should free a slave that is holding SDA low, by
+// clocking SCL up to nine times until SDA is released and then
+// sending a STOP, and return true if the bus is then idle. The
+// default does nothing and returns false. For the platform's I2C bus,
+// define MCP79412RTC_SDA_PIN and MCP79412RTC_SCL_PIN to the pin
+// numbers to enable this.
+//
+// On platforms without the i2c object, e.g. when building the driver
+// for a Linux host (see extras/linux), define MCP79412RTC_NO_DEFAULT_BUS.
+// Then there is no MCP79412I2CBus, no rtcI2C and no RTC object, and
+// every MCP79412RTC object must be given a bus.
+//
+// The bus constructors are constexpr and do not touch the hardware,
+// so global bus objects are initialized at compile time; the bus is
+// initialized by begin().
+
+#ifndef MCP79412BUS_H_INCLUDED
+#define MCP79412BUS_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+
+class MCP79412MuxBus;
+
+class MCP79412Bus
+{
+    public:
+        constexpr MCP79412Bus() : m_muxSelected(0) {}
+        virtual void begin() = 0;
+        virtual void beginTransmission(uint8_t addr) = 0;
+        virtual size_t write(uint8_t value) = 0;
+        virtual uint8_t endTransmission() = 0;
+        virtual uint8_t requestFrom(uint8_t addr, uint8_t nBytes) = 0;
+        virtual int read() = 0;
+        virtual bool recover() { return false; }
+
+    private:
+        friend class MCP79412MuxBus;
+        MCP79412MuxBus *m_muxSelected;  // multiplexer channel selected last on this bus, 0 if none
+};
+
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
+// The platform's I2C bus.
+class MCP79412I2CBus : public MCP79412Bus
+{
+    public:
+        void begin();
+        void beginTransmission(uint8_t addr);
+        size_t write(uint8_t value);
+        uint8_t endTransmission();
+        uint8_t requestFrom(uint8_t addr, uint8_t nBytes);
+        int read();
+#if defined(MCP79412RTC_SDA_PIN) && defined(MCP79412RTC_SCL_PIN)
+        bool recover();
+#endif
+};
+#endif
+
+// One channel of a TCA9548A I2C multiplexer. The channel is selected
+// before each transaction, unless it was the last one selected. When
+// there is more than one multiplexer on the same bus, the channel of
+// the other multiplexer is turned off first, so that two RTCs at the
+// same address are never connected at once. If the multiplexer does
+// not respond, the transaction is not started, and endTransmission()
+// returns the multiplexer's status, or requestFrom() returns zero. If
+// a transaction fails, the channel is selected again for the next.
+class MCP79412MuxBus : public MCP79412Bus
+{
+    public:
+        constexpr MCP79412MuxBus(MCP79412Bus &bus, uint8_t muxAddr, uint8_t channel)
+            : m_bus(bus), m_muxAddr(muxAddr), m_channel(channel & 0x07), m_selectStatus(0) {}
+        void begin();
+        void beginTransmission(uint8_t addr);
+        size_t write(uint8_t value);
+        uint8_t endTransmission();
+        uint8_t requestFrom(uint8_t addr, uint8_t nBytes);
+        int read();
+        bool recover();
+
+    private:
+        uint8_t select();
+        uint8_t muxWrite(uint8_t value);
+
+        MCP79412Bus &m_bus;             // bus the multiplexer is on
+        uint8_t m_muxAddr;              // multiplexer I2C address, 0x70-0x77
+        uint8_t m_channel;              // multiplexer channel, 0-7
+        uint8_t m_selectStatus;         // endTransmission() status of the select for the transaction in progress
+};
+
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
+extern MCP79412I2CBus rtcI2C;
+#endif
+
+#endif
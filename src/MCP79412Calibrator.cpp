@@ -0,0 +1,97 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Automatic calibration for the MCP7941x. See MCP79412Calibrator.h
+// for details.
+
+#include <MCP79412Calibrator.h>
+
+#define PPM_PER_STEP 1.017      // one calibration step is 2 clock cycles per minute, 2 / (32768 * 60)
+#define EDGE_LEAD 1500          // ms before a transition is due to start waiting for it
+#define MIN_INTERVAL 2          // shortest measurement interval, seconds, longer than EDGE_LEAD
+
+MCP79412Calibrator::MCP79412Calibrator(MCP79412RTC &rtc, uint32_t (*refMillis)())
+    : m_rtc(rtc), m_refMillis(refMillis), m_state(CAL_IDLE), m_interval(1800),
+      m_target(1.0), m_maxIter(5), m_iter(0), m_trim(0), m_drift(0),
+      m_rtcStart(0), m_refStart(0)
+{
+}
+
+// Start calibrating. Each measurement takes interval seconds; after
+// each one the calibration register is adjusted, until the measured
+// drift is within targetPpm, or maxIterations measurements have been
+// made. Calibration starts from the current calibration register
+// value, so a board that is already close will finish after one
+// measurement. The interval must be at least MIN_INTERVAL seconds,
+// else the state is set to CAL_FAILED.
+void MCP79412Calibrator::begin(uint16_t interval, float targetPpm, byte maxIterations)
+{
+    if (interval < MIN_INTERVAL) {
+        m_state = CAL_FAILED;
+        return;
+    }
+    m_interval = interval;
+    m_target = targetPpm;
+    m_maxIter = maxIterations;
+    m_iter = 0;
+    m_drift = 0;
+    m_trim = m_rtc.calibRead();
+    m_state = CAL_STARTING;
+}
+
+// Run the calibrator. Call frequently from loop(). Returns the
+// current state; calibration is complete when this returns CAL_DONE
+// or CAL_FAILED. Returns quickly except when a seconds transition is
+// due, when it blocks for up to about two seconds to catch it.
+byte MCP79412Calibrator::update()
+{
+    time_t t;
+    uint32_t ms;
+    int32_t refElapsed, rtcElapsed;
+    int step;
+
+    if (m_state == CAL_STARTING) {
+        m_state = m_rtc.waitSecond(&m_rtcStart, refClock, this, 0, &m_refStart) ? CAL_MEASURING : CAL_FAILED;
+    }
+    else if (m_state == CAL_MEASURING) {
+        // wake up a little before the transition is due
+        if (m_refMillis() - m_refStart < (uint32_t)m_interval * 1000 - EDGE_LEAD) return m_state;
+        if (!m_rtc.waitSecond(&t, refClock, this, 0, &ms)) {
+            m_state = CAL_FAILED;
+            return m_state;
+        }
+
+        // positive drift means the RTC is fast, which a positive trim corrects
+        refElapsed = ms - m_refStart;
+        rtcElapsed = (t - m_rtcStart) * 1000;
+        m_drift = (float)(rtcElapsed - refElapsed) * 1e6 / refElapsed;
+        ++m_iter;
+
+        if (m_drift <= m_target && m_drift >= -m_target) {
+            m_state = CAL_DONE;
+        }
+        else {
+            step = (m_drift > 0 ? m_drift + PPM_PER_STEP / 2 : m_drift - PPM_PER_STEP / 2) / PPM_PER_STEP;
+            if (m_iter >= m_maxIter || m_trim + step > 127 || m_trim + step < -127) {
+                m_state = CAL_FAILED;
+            }
+            else if (step != 0) {
+                m_trim += step;
+                m_rtc.calibWrite(m_trim);
+            }
+            // the next measurement starts at this transition
+            m_rtcStart = t;
+            m_refStart = ms;
+        }
+    }
+    return m_state;
+}
+
+// The reference time, for MCP79412RTC::waitSecond() to note when the
+// RTC's seconds change.
+uint32_t MCP79412Calibrator::refClock(void *cal)
+{
+    return ((MCP79412Calibrator*)cal)->m_refMillis();
+}
@@ -0,0 +1,59 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Automatic calibration for the MCP7941x. Measures the RTC's drift
+// against a reference clock, sets the calibration register to correct
+// it, and repeats until the remaining drift is within a target.
+//
+// The reference is a function supplied by the caller that returns a
+// time in milliseconds, e.g. millis() on an MCU with a crystal or TCXO
+// known to be better than the RTC, a count of GPS PPS pulses times
+// 1000, or the time from a host or NTP-disciplined clock received
+// over a serial link. The RTC is timed at its seconds transitions,
+// which are found by polling, so the resolution of one measurement is
+// about +/-2ms; over the default interval of 30 minutes, that is
+// about +/-1ppm.
+
+#ifndef MCP79412CALIBRATOR_H_INCLUDED
+#define MCP79412CALIBRATOR_H_INCLUDED
+
+#include <MCP79412RTC.h>
+
+// Calibrator states, returned by update()
+enum {
+    CAL_IDLE,           // begin() not called yet
+    CAL_STARTING,       // waiting for the first seconds transition
+    CAL_MEASURING,      // measuring drift
+    CAL_DONE,           // drift is within the target
+    CAL_FAILED          // no RTC, or drift could not be brought within the target
+};
+
+class MCP79412Calibrator
+{
+    public:
+        MCP79412Calibrator(MCP79412RTC &rtc, uint32_t (*refMillis)());
+        void begin(uint16_t interval = 1800, float targetPpm = 1.0, byte maxIterations = 5);
+        byte update();
+        byte state() { return m_state; }
+        float drift() { return m_drift; }
+        int trim() { return m_trim; }
+
+    private:
+        static uint32_t refClock(void *cal);
+
+        MCP79412RTC &m_rtc;
+        uint32_t (*m_refMillis)();  // reference clock
+        byte m_state;               // CAL_IDLE, CAL_MEASURING, etc.
+        uint16_t m_interval;        // measurement interval, seconds
+        float m_target;             // target drift, ppm
+        byte m_maxIter;             // maximum number of measurements
+        byte m_iter;                // measurements made
+        int m_trim;                 // calibration register value
+        float m_drift;              // drift from the last measurement, ppm, positive if the RTC is fast
+        time_t m_rtcStart;          // RTC time at the start of the measurement
+        uint32_t m_refStart;        // reference time at the start of the measurement
+};
+
+#endif
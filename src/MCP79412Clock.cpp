@@ -0,0 +1,188 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// A cached copy of the RTC's time that can be read from an interrupt
+// service routine. See MCP79412Clock.h for details.
+
+#include <MCP79412Clock.h>
+
+#define MAX_SCALE 16777215L         // largest correction elapsedUs() applies, just under 2^24
+
+MCP79412Clock::MCP79412Clock(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_ticking(false), m_seq(0), m_ticks(0), m_tickUs(0), m_nextScale(0)
+{
+    for (byte i=0; i<2; i++) {
+        m_time[i] = 0;
+        m_us[i] = 0;
+        m_tickAt[i] = 0;
+        m_scale[i] = 0;
+    }
+}
+
+// Start the clock. With ticking true, turns on the RTC's 1Hz square
+// wave; tick() must then be called on the edge of it at which the
+// seconds change, e.g. by attachInterrupt(). Then syncs the clock.
+// Returns false if the RTC could not be read.
+bool MCP79412Clock::begin(bool ticking)
+{
+    m_ticking = ticking;
+    if (ticking && m_rtc.squareWave(SQWAVE_1_HZ) != RTC_OK) return false;
+    return sync();
+}
+
+// Read the RTC and update the copy. Call from loop(), not from an
+// ISR, e.g. once a minute, or once an hour at most if not ticking.
+// Returns false if the RTC could not be read; the copy is then
+// unchanged.
+bool MCP79412Clock::sync()
+{
+    time_t t;
+    uint32_t us, before, after;
+
+    // a tick during the read would pair the time with the wrong count
+    for (byte tries=0; tries<3; tries++) {
+        before = readTicks();
+        t = m_rtc.getTime();
+        us = MCP79412RTC_MICROS();
+        after = readTicks();
+        if (m_rtc.lastStatus() != RTC_OK) return false;
+        if (before == after) {
+            byte next = (m_seq + 1) & 1;
+            m_time[next] = t;
+            m_us[next] = us;
+            m_tickAt[next] = after;
+            m_scale[next] = m_nextScale;
+            byte seq = m_seq + 1;
+            m_seq = (seq == 0) ? 2 : seq;   // 0 means never synced
+            return true;
+        }
+    }
+    return false;
+}
+
+// Correct the extrapolation from MCP79412RTC_MICROS() for the MCU
+// clock's error in ppm, positive if it is fast, e.g. as measured by
+// MCP79412FreqMeter::ppm(). Takes effect at the next sync(). The
+// correction is limited to the range elapsedUs() can apply, an MCU
+// clock up to about half as slow as the RTC.
+void MCP79412Clock::setCorrection(float ppm)
+{
+    float scale = ppm / (1e6 + ppm) * 16777216.0 + (ppm < 0 ? -0.5 : 0.5);
+
+    if (ppm <= -500000.0 || scale < -MAX_SCALE) {
+        scale = -MAX_SCALE;
+    }
+    else if (scale > MAX_SCALE) {
+        scale = MAX_SCALE;
+    }
+    m_nextScale = scale;
+}
+
+// Count a second. Call from the interrupt on the RTC's 1Hz square wave.
+void MCP79412Clock::tick()
+{
+    m_ticks++;
+    m_tickUs = MCP79412RTC_MICROS();
+}
+
+// Returns the time, from the copy. Safe to call from an ISR. Returns
+// zero if the clock has not been synced.
+time_t MCP79412Clock::now()
+{
+    time_t t;
+    uint32_t us, ticks;
+    int32_t scale;
+
+    if (!read(&t, &us, &ticks, &scale)) return 0;
+    if (m_ticking) return t + (readTicks() - ticks);
+    return t + elapsedUs(us, scale) / 1000000UL;
+}
+
+// Returns the time, from the copy, and sets *us to the microseconds
+// since the second began; if not ticking, these are counted from the
+// sync, not from the RTC's second. Safe to call from an ISR. Returns
+// zero if the clock has not been synced.
+time_t MCP79412Clock::now(uint32_t *us)
+{
+    time_t t;
+    uint32_t syncUs, syncTicks, ticks, tickUs, elapsed;
+    int32_t scale;
+
+    if (!read(&t, &syncUs, &syncTicks, &scale)) {
+        *us = 0;
+        return 0;
+    }
+    if (m_ticking) {
+        do {
+            ticks = m_ticks;
+            tickUs = m_tickUs;
+        } while (ticks != m_ticks);
+        elapsed = elapsedUs(tickUs, scale);
+        *us = (elapsed < 1000000UL) ? elapsed : 999999UL;   // a late tick
+        return t + (ticks - syncTicks);
+    }
+    elapsed = elapsedUs(syncUs, scale);
+    *us = elapsed % 1000000UL;
+    return t + elapsed / 1000000UL;
+}
+
+// Returns (us * scale) >> 24, less up to 1, for a scale under 2^24,
+// from 16 by 16 bit products, which an AVR multiplies in hardware;
+// a 64-bit product takes a library call of several hundred cycles,
+// too long for an ISR.
+static uint32_t scaleUs(uint32_t us, uint32_t scale)
+{
+    uint16_t usHi = us >> 16, usLo = us;
+    uint16_t scaleHi = scale >> 8;
+    uint8_t scaleLo = scale;
+
+    return (uint32_t)usHi * scaleHi +
+        (((uint32_t)usHi * scaleLo + (((uint32_t)usLo * scaleHi) >> 8)) >> 8);
+}
+
+// Returns the microseconds since the given MCP79412RTC_MICROS(),
+// corrected for the MCU clock's error.
+uint32_t MCP79412Clock::elapsedUs(uint32_t since, int32_t scale)
+{
+    uint32_t us = MCP79412RTC_MICROS() - since;
+
+    if (scale > 0) {
+        us -= scaleUs(us, scale);
+    }
+    else if (scale < 0) {
+        us += scaleUs(us, -scale);
+    }
+    return us;
+}
+
+// Read the tick count, which the tick() interrupt may change between
+// the bytes of the read on an 8-bit MCU.
+uint32_t MCP79412Clock::readTicks()
+{
+    uint32_t ticks;
+
+    do {
+        ticks = m_ticks;
+    } while (ticks != m_ticks);
+    return ticks;
+}
+
+// Copy the buffer in use, trying again if sync() switched buffers
+// meanwhile. Returns false if the clock has not been synced.
+bool MCP79412Clock::read(time_t *t, uint32_t *us, uint32_t *ticks, int32_t *scale)
+{
+    byte seq;
+
+    do {
+        seq = m_seq;
+        if (seq == 0) return false;
+        byte i = seq & 1;
+        *t = m_time[i];
+        *us = m_us[i];
+        *ticks = m_tickAt[i];
+        *scale = m_scale[i];
+    } while (seq != m_seq);
+    return true;
+}
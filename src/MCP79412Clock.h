@@ -0,0 +1,64 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// A cached copy of the RTC's time that can be read from an interrupt
+// service routine. Reading the RTC uses the bus, so it cannot be done
+// from an ISR; instead, sync() reads the RTC from loop(), and now()
+// gives the time from the copy, in a few cycles, without using the
+// bus or disabling interrupts.
+//
+// Between syncs the time is kept in one of two ways. With begin(true),
+// the RTC's MFP puts out its 1Hz square wave, the application attaches
+// tick() to it as an interrupt on the edge at which the seconds
+// change, and each tick advances the time by a second. Otherwise the
+// time is extrapolated with MCP79412RTC_MICROS() from the last sync,
+// which must then be called at least once an hour (micros() wraps
+// after 71 minutes); as the time is read at an unknown point in the
+// second, it is good only to within a second. The MCU clock's error,
+// as measured by MCP79412FreqMeter, can be given to setCorrection()
+// to correct the extrapolation from the next sync on.
+//
+// The copy is double-buffered: sync() writes the buffer not in use
+// and then switches to it by incrementing a sequence count, and now()
+// copies the buffer in use and tries again if the count changed while
+// it did. An ISR cannot be interrupted by loop(), so there it never
+// needs to try again.
+
+#ifndef MCP79412CLOCK_H_INCLUDED
+#define MCP79412CLOCK_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <MCP79412Port.h>
+
+class MCP79412Clock
+{
+    public:
+        MCP79412Clock(MCP79412RTC &rtc);
+        bool begin(bool ticking = false);
+        bool sync();
+        void tick();
+        time_t now();
+        time_t now(uint32_t *us);
+        bool valid() { return m_seq != 0; }
+        void setCorrection(float ppm);
+
+    private:
+        uint32_t readTicks();
+        bool read(time_t *t, uint32_t *us, uint32_t *ticks, int32_t *scale);
+        uint32_t elapsedUs(uint32_t since, int32_t scale);
+
+        MCP79412RTC &m_rtc;
+        bool m_ticking;                 // tick() keeps the time between syncs
+        volatile time_t m_time[2];      // RTC time at the sync
+        volatile uint32_t m_us[2];      // MCP79412RTC_MICROS() at the sync
+        volatile uint32_t m_tickAt[2];  // tick count at the sync
+        volatile int32_t m_scale[2];    // MCU clock error, ppm / (1e6 + ppm) * 2^24
+        volatile uint8_t m_seq;         // buffer m_seq & 1 is in use; 0 until the first sync
+        volatile uint32_t m_ticks;      // ticks since begin()
+        volatile uint32_t m_tickUs;     // MCP79412RTC_MICROS() at the last tick
+        int32_t m_nextScale;            // from setCorrection(), for the next sync
+};
+
+#endif
@@ -0,0 +1,139 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Persistent boot count and cumulative on-time for the MCP7941x.
+// See MCP79412Counters.h for details.
+
+#include <MCP79412Counters.h>
+
+#define COUNTERS_SIZE 10        // SRAM bytes: boot count (4), on-time (4), boots since checkpoint (1), CRC (1)
+#define MAX_UPDATE_GAP 3600     // larger gaps between update() calls are taken to be the clock being set
+
+static void put32(byte *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t get32(const byte *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+MCP79412Counters::MCP79412Counters(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_ring(rtc), m_loaded(false), m_sramAddr(0), m_interval(16), m_bootsSince(0),
+      m_bootCount(0), m_onTime(0), m_checkpointTime(0), m_checkpointBoots(0), m_lastTime(0)
+{
+}
+
+// Load the counters and count a boot. To be called once in setup().
+// The counters are kept at SRAM address sramAddr (10 bytes) and
+// checkpointed to a ring of nPages EEPROM pages starting at address
+// eepromAddr, every checkpointInterval boots. If the SRAM block is not
+// valid (i.e. the backup battery failed), the counters are restored
+// from the latest checkpoint, and a new checkpoint is written straight
+// away. Returns false if the SRAM block or the EEPROM ring do not fit,
+// or the counters could not be loaded because of a bus error; the
+// counters are then left alone, in SRAM and EEPROM, until begin()
+// succeeds. Also returns false if the boot could not be written to
+// SRAM, or a checkpoint that was due could not be written to EEPROM;
+// the counters are loaded, and the checkpoint is tried again at the
+// next boot.
+bool MCP79412Counters::begin(byte sramAddr, byte eepromAddr, byte nPages, byte checkpointInterval)
+{
+    byte buf[COUNTERS_SIZE];
+    uint32_t key, bootCount;
+    bool restored = false;
+
+    m_loaded = false;
+    if (sramAddr + COUNTERS_SIZE > 64 || !m_ring.begin(MEM_EEPROM, eepromAddr, nPages))
+        return false;
+    m_sramAddr = sramAddr;
+    m_interval = checkpointInterval;
+    m_lastTime = 0;
+
+    if (m_ring.newest(&key, &bootCount)) {
+        m_checkpointTime = key - bootCount;
+        m_checkpointBoots = bootCount;
+    }
+    else {
+        if (m_rtc.lastStatus() != RTC_OK) return false;
+        m_checkpointTime = 0;
+        m_checkpointBoots = 0;
+    }
+
+    if (m_rtc.sramRead(m_sramAddr, buf, COUNTERS_SIZE) != RTC_OK) return false;
+    if (buf[COUNTERS_SIZE - 1] == MCP79412RTC::crc8(buf, COUNTERS_SIZE - 1)) {
+        m_bootCount = get32(&buf[0]);
+        m_onTime = get32(&buf[4]);
+        m_bootsSince = buf[8];
+    }
+    else {
+        m_bootCount = m_checkpointBoots;
+        m_onTime = m_checkpointTime;
+        m_bootsSince = 0;
+        restored = true;
+    }
+
+    m_loaded = true;
+    ++m_bootCount;
+    if (++m_bootsSince >= m_interval || restored)
+        return checkpoint();
+    else
+        return save();
+}
+
+// Accumulate on-time. Call periodically, e.g. once a minute, with the
+// current time (e.g. from the Time library's now() function, so no
+// I2C read is needed). Writes the counters to SRAM, never to EEPROM.
+// On-time since the last call is lost at a power failure, and jumps
+// of more than an hour (e.g. the clock being set) are not counted.
+void MCP79412Counters::update(time_t now)
+{
+    if (!m_loaded) return;
+    if (m_lastTime != 0 && now > m_lastTime && now - m_lastTime <= MAX_UPDATE_GAP) {
+        m_onTime += now - m_lastTime;
+        save();
+    }
+    m_lastTime = now;
+}
+
+// Write the counters to the next EEPROM page in the ring. This happens
+// automatically every checkpointInterval boots; the application
+// should also call it when powerFail() reports an outage, since the
+// counters were then kept only by the backup battery. Skipped if
+// nothing has changed since the last checkpoint. Returns false if
+// the counters could not be written.
+bool MCP79412Counters::checkpoint()
+{
+    if (!m_loaded) return false;
+    if (m_onTime != m_checkpointTime || (m_bootCount & 0xFFFFFF) != m_checkpointBoots) {
+        // neither counter goes back and one of them has changed, so the
+        // key, their sum, increases from one checkpoint to the next
+        if (!m_ring.append(m_onTime + (m_bootCount & 0xFFFFFF), m_bootCount)) {
+            save();
+            return false;
+        }
+        m_checkpointTime = m_onTime;
+        m_checkpointBoots = m_bootCount & 0xFFFFFF;
+    }
+    m_bootsSince = 0;
+    return save();
+}
+
+// Write the counters to SRAM. Returns false if they could not be
+// written.
+bool MCP79412Counters::save()
+{
+    byte buf[COUNTERS_SIZE];
+
+    put32(&buf[0], m_bootCount);
+    put32(&buf[4], m_onTime);
+    buf[8] = m_bootsSince;
+    buf[COUNTERS_SIZE - 1] = MCP79412RTC::crc8(buf, COUNTERS_SIZE - 1);
+    return m_rtc.sramWrite(m_sramAddr, buf, COUNTERS_SIZE) == RTC_OK;
+}
@@ -0,0 +1,51 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Persistent boot count and cumulative on-time for the MCP7941x.
+// The counters are kept in a 10-byte block in the RTC's battery-backed
+// SRAM, and checkpointed to EEPROM only every few boots (and when the
+// application asks, e.g. after a power failure), so that they survive
+// a dead battery without an EEPROM write on every boot.
+//
+// Checkpoints go into a ring of EEPROM pages (see MCP79412Ring.h),
+// each one to the page after the last, so wear is spread evenly over
+// the pages given to the ring. A checkpoint stores the lower 24 bits
+// of the boot count, and, as the ring key, the sum of those and the
+// on-time in seconds, which increases at every checkpoint whichever
+// of the two counters has changed.
+
+#ifndef MCP79412COUNTERS_H_INCLUDED
+#define MCP79412COUNTERS_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <MCP79412Ring.h>
+
+class MCP79412Counters
+{
+    public:
+        MCP79412Counters(MCP79412RTC &rtc);
+        bool begin(byte sramAddr, byte eepromAddr, byte nPages, byte checkpointInterval = 16);
+        void update(time_t now);
+        bool checkpoint();
+        uint32_t bootCount() { return m_bootCount; }
+        uint32_t onTime() { return m_onTime; }
+
+    private:
+        bool save();
+
+        MCP79412RTC &m_rtc;
+        MCP79412Ring m_ring;
+        bool m_loaded;              // begin() has loaded the counters
+        byte m_sramAddr;            // SRAM address of the counter block
+        byte m_interval;            // boots between checkpoints
+        byte m_bootsSince;          // boots since the last checkpoint
+        uint32_t m_bootCount;       // number of boots
+        uint32_t m_onTime;          // cumulative on-time in seconds
+        uint32_t m_checkpointTime;  // on-time at the last checkpoint
+        uint32_t m_checkpointBoots; // boot count (lower 24 bits) at the last checkpoint
+        time_t m_lastTime;          // time of the last update(), zero if none
+};
+
+#endif
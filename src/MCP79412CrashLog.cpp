@@ -0,0 +1,160 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Crash log for the MCP7941x. See MCP79412CrashLog.h for details.
+
+#include <MCP79412CrashLog.h>
+
+#define CRASH_SRAM_SIZE 64      // number of bytes of RTC SRAM
+#define CRASH_RECORD_SIZE 8     // bytes per record
+#define CRASH_MAX_UPTIME 0xFFFFFFUL
+
+// Advance a sequence number, skipping zero which marks an empty slot.
+static byte nextSeq(byte seq)
+{
+    return (seq == 255) ? 1 : seq + 1;
+}
+
+MCP79412CrashLog::MCP79412CrashLog(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_addr(0), m_nRecords(0), m_next(0), m_seq(1)
+{
+}
+
+// Define the SRAM area used for the log, starting at SRAM address
+// addr (0-63) and holding nRecords records of 8 bytes each. Reads the
+// log to find where the next record goes, so must be called at boot
+// before record() can be used.
+// Returns false if the area does not fit in SRAM, or the log could
+// not be read; record() then does nothing until begin() succeeds.
+bool MCP79412CrashLog::begin(byte addr, byte nRecords)
+{
+    byte buf[CRASH_SRAM_SIZE];
+
+    if (nRecords < 1 || addr + nRecords * CRASH_RECORD_SIZE > CRASH_SRAM_SIZE) {
+        m_nRecords = 0;
+        return false;
+    }
+    m_addr = addr;
+    m_nRecords = nRecords;
+    m_next = 0;
+    m_seq = 1;
+
+    // the newest record is the one not followed by its successor
+    if (readSlots(buf) != RTC_OK) {
+        m_nRecords = 0;
+        return false;
+    }
+    for (byte i=0; i<m_nRecords; i++) {
+        byte seq = buf[i * CRASH_RECORD_SIZE];
+        byte j = (i + 1) % m_nRecords;
+        if (seq != 0 && buf[j * CRASH_RECORD_SIZE] != nextSeq(seq)) {
+            m_next = j;
+            m_seq = nextSeq(seq);
+            break;
+        }
+    }
+    return true;
+}
+
+// Add a record to the log, overwriting the oldest one if the log is
+// full. This is a single 8-byte SRAM write with no allocation and no
+// reads from the RTC, but it uses the bus, with its retries and
+// delays, so it must not be called from an ISR: on an AVR the Wire
+// library hangs there. A fault handler or watchdog interrupt should
+// save the fault in RAM that is not cleared at reset, and the next
+// boot record it (see README.md). If the record cannot be written,
+// the next record goes to the same slot.
+void MCP79412CrashLog::record(byte code, uint32_t pc, uint32_t uptime)
+{
+    byte buf[CRASH_RECORD_SIZE];
+    byte slot = m_next;
+
+    if (m_nRecords == 0) return;
+    if (uptime > CRASH_MAX_UPTIME) uptime = CRASH_MAX_UPTIME;
+    buf[0] = m_seq;
+    buf[1] = code;
+    buf[2] = pc;
+    buf[3] = pc >> 8;
+    buf[4] = pc >> 16;
+    buf[5] = uptime;
+    buf[6] = uptime >> 8;
+    buf[7] = uptime >> 16;
+    if (m_rtc.sramWrite(m_addr + slot * CRASH_RECORD_SIZE, buf, CRASH_RECORD_SIZE) != RTC_OK) return;
+
+    m_next = (slot + 1) % m_nRecords;
+    m_seq = nextSeq(m_seq);
+}
+
+// Returns the number of records in the log, or zero if it could not
+// be read.
+byte MCP79412CrashLog::count()
+{
+    byte buf[CRASH_SRAM_SIZE];
+    byte n = 0;
+
+    if (m_nRecords == 0 || readSlots(buf) != RTC_OK) return 0;
+    for (byte i=0; i<m_nRecords; i++) {
+        if (buf[i * CRASH_RECORD_SIZE] != 0) ++n;
+    }
+    return n;
+}
+
+// Copy the records in the log to the caller's array, oldest first,
+// then clear the log. If there are more than maxRecords records, only
+// the newest maxRecords are returned. Returns the number of records
+// copied. If the log could not be read, returns zero and leaves the
+// log as it is.
+byte MCP79412CrashLog::drain(crashRecord_t *records, byte maxRecords)
+{
+    byte buf[CRASH_SRAM_SIZE];
+    byte nValid = 0;
+    byte n = 0;
+
+    if (m_nRecords == 0 || readSlots(buf) != RTC_OK) return 0;
+    for (byte i=0; i<m_nRecords; i++) {
+        if (buf[i * CRASH_RECORD_SIZE] != 0) ++nValid;
+    }
+
+    // the oldest record is at the slot to be written next, or the
+    // first slot if the log has not wrapped yet
+    for (byte i=0; i<m_nRecords; i++) {
+        byte *r = &buf[ ((m_next + i) % m_nRecords) * CRASH_RECORD_SIZE ];
+        if (r[0] == 0) continue;
+        if (nValid-- > maxRecords) continue;
+        records[n].code = r[1];
+        records[n].pc = r[2] | (uint32_t)r[3] << 8 | (uint32_t)r[4] << 16;
+        records[n].uptime = r[5] | (uint32_t)r[6] << 8 | (uint32_t)r[7] << 16;
+        ++n;
+    }
+    clear();
+    return n;
+}
+
+// Read the whole log into buf, in as few transactions as the
+// I2C buffer allows.
+rtcStatus_t MCP79412CrashLog::readSlots(byte *buf)
+{
+    const byte chunk = (BUFFER_LENGTH / CRASH_RECORD_SIZE) * CRASH_RECORD_SIZE;
+    byte nBytes = m_nRecords * CRASH_RECORD_SIZE;
+
+    for (byte i=0; i<nBytes; i+=chunk) {
+        byte n = (nBytes - i < chunk) ? nBytes - i : chunk;
+        rtcStatus_t status = m_rtc.sramRead(m_addr + i, buf + i, n);
+        if (status != RTC_OK) return status;
+    }
+    return RTC_OK;
+}
+
+// Remove all records from the log.
+void MCP79412CrashLog::clear()
+{
+    byte zeros[CRASH_RECORD_SIZE] = {0};
+
+    for (byte i=0; i<m_nRecords; i++) {
+        m_rtc.sramWrite(m_addr + i * CRASH_RECORD_SIZE, zeros, CRASH_RECORD_SIZE);
+    }
+    m_next = 0;
+    m_seq = 1;
+}
@@ -0,0 +1,59 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Crash log for the MCP7941x. Records fault codes, program counter and
+// uptime in a small ring in the RTC's battery-backed SRAM, where they
+// survive the reset that follows the fault, to be drained at the
+// next boot.
+//
+// Each record is 8 bytes: a sequence number (zero means the slot is
+// empty), the fault code, 24 bits of program counter and 24 bits of
+// uptime in seconds. The whole SRAM holds 8 records.
+
+#ifndef MCP79412CRASHLOG_H_INCLUDED
+#define MCP79412CRASHLOG_H_INCLUDED
+
+#include <MCP79412RTC.h>
+
+// Fault codes for use with the record() function.
+// Application-defined codes can start at CRASH_USER.
+enum {
+    CRASH_NONE,
+    CRASH_HARDFAULT,
+    CRASH_WATCHDOG,
+    CRASH_BROWNOUT,
+    CRASH_ASSERT,
+    CRASH_STACK_OVERFLOW,
+    CRASH_USER = 0x80
+};
+
+// A crash record as returned by drain()
+struct crashRecord_t {
+    byte code;              // fault code
+    uint32_t pc;            // program counter, lower 24 bits
+    uint32_t uptime;        // seconds since boot, saturates at 0xFFFFFF
+};
+
+class MCP79412CrashLog
+{
+    public:
+        MCP79412CrashLog(MCP79412RTC &rtc);
+        bool begin(byte addr = 0, byte nRecords = 8);
+        void record(byte code, uint32_t pc, uint32_t uptime);
+        byte count();
+        byte drain(crashRecord_t *records, byte maxRecords);
+        void clear();
+
+    private:
+        rtcStatus_t readSlots(byte *buf);
+
+        MCP79412RTC &m_rtc;
+        byte m_addr;                // first SRAM address of the ring
+        byte m_nRecords;            // number of slots in the ring
+        volatile byte m_next;       // slot to be written by the next record()
+        volatile byte m_seq;        // sequence number for the next record()
+};
+
+#endif
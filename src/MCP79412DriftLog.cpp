@@ -0,0 +1,168 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Drift log for the MCP7941x. See MCP79412DriftLog.h for details.
+
+#include <MCP79412DriftLog.h>
+
+#define MAX_SAMPLES 16                  // samples that fit in EEPROM
+#define MS_PER_DAY 86400000.0
+#define PPM_PER_STEP 1.017              // one calibration step is 2 clock cycles per minute
+#define MIN_AGING_DAYS 30.0             // minimum span of samples to fit aging
+
+MCP79412DriftLog::MCP79412DriftLog(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_ring(rtc), m_valid(false), m_tm(0), m_a(0), m_b(0), m_c(0)
+{
+}
+
+// Define the memory used for the log: room for maxSamples samples of
+// 8 bytes each, starting at address addr in SRAM (memType ==
+// MEM_SRAM) or EEPROM (memType == MEM_EEPROM). Reads the samples
+// already logged to rebuild the fit. Must be called before the other
+// functions. Returns false if the log does not fit in the memory.
+bool MCP79412DriftLog::begin(byte memType, byte addr, byte maxSamples)
+{
+    m_valid = false;
+    if (maxSamples > MAX_SAMPLES || !m_ring.begin(memType, addr, maxSamples)) return false;
+    fit();
+    return true;
+}
+
+// Log a sample: the reference time, and the RTC's offset from the
+// reference in milliseconds, positive if the RTC is ahead. Samples
+// must be added in time order. When the log is full, the oldest
+// sample is dropped from the fit as well as from the log. After the
+// calibration register is changed, clear() the log, since the old
+// samples no longer describe the RTC's drift.
+void MCP79412DriftLog::addSample(time_t refTime, int32_t offset)
+{
+    if (m_ring.append(refTime, (uint32_t)offset & 0xFFFFFF)) fit();
+}
+
+// Returns the predicted offset of the RTC in milliseconds at time t,
+// positive if the RTC is ahead. Zero if there are no samples.
+int32_t MCP79412DriftLog::predictedOffset(time_t t)
+{
+    if (!m_valid) return 0;
+    float x = days(t);
+    float y = m_a + m_b * x + m_c * x * x;
+    return (y < 0) ? (int32_t)(y - 0.5) : (int32_t)(y + 0.5);
+}
+
+// Correct a time read from the RTC by the predicted offset,
+// to the nearest second.
+time_t MCP79412DriftLog::correct(time_t rtcTime)
+{
+    int32_t offset = predictedOffset(rtcTime);
+
+    return rtcTime - (offset < 0 ? offset - 500 : offset + 500) / 1000;
+}
+
+// Returns the drift at time t in ppm, positive if the RTC is fast.
+float MCP79412DriftLog::drift(time_t t)
+{
+    if (!m_valid) return 0;
+    return (m_b + 2 * m_c * days(t)) * 1e6 / MS_PER_DAY;
+}
+
+// Returns the aging, i.e. the change in drift, in ppm per day.
+// Zero until the samples span at least 30 days.
+float MCP79412DriftLog::aging()
+{
+    if (!m_valid) return 0;
+    return 2 * m_c * 1e6 / MS_PER_DAY;
+}
+
+// Returns the calibration register value that would cancel the
+// drift at time t.
+int MCP79412DriftLog::recommendedTrim(time_t t)
+{
+    float steps = drift(t) / PPM_PER_STEP;
+    int trim = m_rtc.calibRead() + (int)(steps < 0 ? steps - 0.5 : steps + 0.5);
+
+    if (trim > 127) trim = 127;
+    if (trim < -127) trim = -127;
+    return trim;
+}
+
+// Remove all samples from the log.
+void MCP79412DriftLog::clear()
+{
+    if (m_ring.clear())
+        m_valid = false;
+    else
+        fit();              // some samples are left
+}
+
+// Returns the days from the mean time of the samples to t.
+float MCP79412DriftLog::days(time_t t)
+{
+    return (float)((int32_t)(t - m_tm)) / 86400;
+}
+
+// Fit the samples in the log with y = a + b*t + c*t^2, by least
+// squares. Time is measured from the samples' mean time, and the
+// quadratic term is taken as the part of t^2 that the constant and
+// linear terms cannot fit, so each coefficient is a simple ratio of
+// sums and there are no large terms to cancel. Falls back to a
+// straight line if the samples span less than 30 days or the
+// quadratic is ill-conditioned, and to a constant if there are fewer
+// than two samples or they all have the same time. If the samples
+// cannot be read, the fit is left as it was.
+void MCP79412DriftLog::fit()
+{
+    uint32_t keys[MAX_SAMPLES], values[MAX_SAMPLES];
+    float x[MAX_SAMPLES], y[MAX_SAMPLES];
+    float dt = 0, ym = 0, sxx = 0, sx3 = 0, sx4 = 0, sxy = 0;
+    byte n = m_ring.read(keys, values, MAX_SAMPLES);
+
+    if (n == 0 && m_rtc.lastStatus() != RTC_OK) return;
+    m_valid = false;
+    m_a = m_b = m_c = 0;
+    if (n == 0) return;
+
+    // the mean time and offset
+    for (byte i=0; i<n; i++) {
+        dt += (int32_t)(keys[i] - keys[0]);
+        y[i] = (values[i] & 0x800000) ? (int32_t)(values[i] | 0xFF000000) : (int32_t)values[i];
+        ym += y[i];
+    }
+    dt /= n;
+    ym /= n;
+    m_tm = keys[0] + (int32_t)(dt < 0 ? dt - 0.5 : dt + 0.5);
+
+    for (byte i=0; i<n; i++) {
+        x[i] = days(keys[i]);
+        y[i] -= ym;
+        float x2 = x[i] * x[i];
+        sxx += x2;
+        sx3 += x2 * x[i];
+        sx4 += x2 * x2;
+        sxy += x[i] * y[i];
+    }
+    m_a = ym;
+    m_valid = true;
+    if (sxx <= 0) return;
+
+    // span of evenly spaced samples is sqrt(12 * variance)
+    if (n >= 3 && sxx / n * 12 >= MIN_AGING_DAYS * MIN_AGING_DAYS) {
+        // q = t^2 - (sx3 / sxx) * t - sxx / n is orthogonal to 1 and t
+        float sqq = 0, sqy = 0;
+        for (byte i=0; i<n; i++) {
+            float q = x[i] * x[i] - sx3 / sxx * x[i] - sxx / n;
+            sqq += q * q;
+            sqy += q * y[i];
+        }
+        if (sqq > 1e-6 * sx4) {
+            m_c = sqy / sqq;
+            m_b = sxy / sxx - m_c * sx3 / sxx;
+            m_a = ym - m_c * sxx / n;
+            return;
+        }
+    }
+
+    // straight line
+    m_b = sxy / sxx;
+}
@@ -0,0 +1,54 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Drift log for the MCP7941x. Records the RTC's offset from a
+// reference (e.g. NTP or GPS) each time one is available, in a ring
+// in the RTC's SRAM or EEPROM (see MCP79412Ring.h), and fits the
+// offsets with a least-squares quadratic in time: the constant term
+// is the offset, the linear term the drift, and the quadratic term
+// the crystal's aging. This predicts the offset between reference
+// syncs, so time can be corrected on nodes that see a reference
+// only occasionally, and gives the calibration value that would
+// remove the drift.
+//
+// Each sample is the reference time and the offset in milliseconds
+// (RTC minus reference, up to +/-8388 seconds). SRAM holds up to 8
+// samples, EEPROM up to 16. The fit is recomputed from the samples in
+// the log each time one is added, with time measured from the samples'
+// mean time so that it stays well conditioned however long the log
+// has run; only its coefficients are kept in RAM.
+
+#ifndef MCP79412DRIFTLOG_H_INCLUDED
+#define MCP79412DRIFTLOG_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <MCP79412Ring.h>
+
+class MCP79412DriftLog
+{
+    public:
+        MCP79412DriftLog(MCP79412RTC &rtc);
+        bool begin(byte memType = MEM_EEPROM, byte addr = 0, byte maxSamples = 16);
+        void addSample(time_t refTime, int32_t offset);
+        int32_t predictedOffset(time_t t);
+        time_t correct(time_t rtcTime);
+        float drift(time_t t);
+        float aging();
+        int recommendedTrim(time_t t);
+        byte count() { return m_ring.count(); }
+        void clear();
+
+    private:
+        void fit();
+        float days(time_t t);
+
+        MCP79412RTC &m_rtc;
+        MCP79412Ring m_ring;
+        bool m_valid;               // there are samples, and m_a .. m_c fit them
+        time_t m_tm;                // mean time of the samples, the time origin for the fit
+        float m_a, m_b, m_c;        // fit y = a + b*t + c*t^2, t in days from m_tm, y in ms
+};
+
+#endif
@@ -0,0 +1,65 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Measures the error of the MCU's clock against the RTC's square
+// wave. See MCP79412FreqMeter.h for details.
+
+#include <MCP79412FreqMeter.h>
+
+MCP79412FreqMeter::MCP79412FreqMeter(MCP79412RTC &rtc, uint16_t (*readCounter)(), uint8_t freq)
+    : m_rtc(rtc), m_readCounter(readCounter), m_freq(freq), m_intervalUs(10000000UL),
+      m_lastCount(0), m_pulses(0), m_startUs(0), m_valid(false), m_ppm(0)
+{
+}
+
+// Turn on the RTC's square wave and start measuring, over intervals
+// of intervalMs. The counter must be set up first. Returns false if
+// the frequency is not 32.768kHz or 4.096kHz, or the RTC could not be
+// written.
+bool MCP79412FreqMeter::begin(uint16_t intervalMs)
+{
+    if (m_freq != SQWAVE_32768_HZ && m_freq != SQWAVE_4096_HZ) return false;
+    if (m_rtc.squareWave(m_freq) != RTC_OK) return false;
+    m_intervalUs = intervalMs * 1000UL;
+    restart(m_readCounter(), MCP79412RTC_MICROS());
+    return true;
+}
+
+// Count the pulses since the last call. Call from loop(), at least
+// every 2 seconds at 32.768kHz. Returns true when a measurement has
+// been completed, after which ppm() has the new value; the next
+// measurement then starts.
+bool MCP79412FreqMeter::update()
+{
+    uint16_t count = m_readCounter();
+    uint32_t us = MCP79412RTC_MICROS();
+
+    m_pulses += (uint16_t)(count - m_lastCount);
+    m_lastCount = count;
+    if (us - m_startUs < m_intervalUs) return false;
+
+    float refUs = m_pulses * (m_freq == SQWAVE_32768_HZ ? 1e6 / 32768 : 1e6 / 4096);
+    if (refUs > 0) {
+        m_ppm = ((us - m_startUs) - refUs) * 1e6 / refUs;
+        m_valid = true;
+    }
+    restart(count, us);
+    return m_valid;
+}
+
+// Convert an interval measured with the MCU's clock (in any unit,
+// e.g. from millis()) to the true interval, from the last measurement.
+uint32_t MCP79412FreqMeter::correct(uint32_t interval)
+{
+    return interval - (int32_t)(interval * (m_ppm / (1e6 + m_ppm)));
+}
+
+// Start a measurement from the given counter and MCU clock readings.
+void MCP79412FreqMeter::restart(uint16_t count, uint32_t us)
+{
+    m_lastCount = count;
+    m_pulses = 0;
+    m_startUs = us;
+}
@@ -0,0 +1,50 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Measures the error of the MCU's clock, as seen by
+// MCP79412RTC_MICROS() (micros() on Arduino), against the RTC's
+// crystal, so that intervals timed with micros() or millis() can be
+// corrected, e.g. on a board running from an internal RC oscillator
+// that is off by a few percent.
+//
+// The RTC's MFP puts out its 32.768kHz or 4.096kHz square wave, which
+// clocks a hardware counter on the MCU, as for MCP79412Stamper, with
+// which the counter can be shared. update() counts the pulses against
+// micros() over each interval. The counter is 16 bits, so update()
+// must be called at least every 2 seconds at 32.768kHz (16 seconds at
+// 4.096kHz). A measurement over 10 seconds is good to about 3ppm at
+// 32.768kHz, plus the RTC's own error.
+
+#ifndef MCP79412FREQMETER_H_INCLUDED
+#define MCP79412FREQMETER_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <MCP79412Port.h>
+
+class MCP79412FreqMeter
+{
+    public:
+        MCP79412FreqMeter(MCP79412RTC &rtc, uint16_t (*readCounter)(), uint8_t freq = SQWAVE_32768_HZ);
+        bool begin(uint16_t intervalMs = 10000);
+        bool update();
+        bool valid() { return m_valid; }
+        float ppm() { return m_ppm; }
+        uint32_t correct(uint32_t interval);
+
+    private:
+        void restart(uint16_t count, uint32_t us);
+
+        MCP79412RTC &m_rtc;
+        uint16_t (*m_readCounter)();
+        uint8_t m_freq;             // SQWAVE_32768_HZ or SQWAVE_4096_HZ
+        uint32_t m_intervalUs;      // measurement interval
+        uint16_t m_lastCount;       // counter at the last update()
+        uint32_t m_pulses;          // pulses counted in this measurement
+        uint32_t m_startUs;         // MCP79412RTC_MICROS() at its start
+        bool m_valid;               // a measurement has been made
+        float m_ppm;                // MCU clock error, positive if fast
+};
+
+#endif
@@ -0,0 +1,172 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Optional instrumentation for the MCP79412RTC driver. See
+// MCP79412Instrument.h for details.
+
+#include <MCP79412Instrument.h>
+#ifdef MCP79412RTC_INSTRUMENT
+#include <string.h>
+
+rtcOpStats_t MCP79412Instrument::m_stats[RTC_OP_COUNT];
+MCP79412RTC_THREAD_LOCAL uint8_t MCP79412Instrument::m_op = RTC_OP_OTHER;
+MCP79412RTC_THREAD_LOCAL bool MCP79412Instrument::m_polling = false;
+
+// Add to a counter, atomically where calls may come from several
+// threads. A histogram bin stops at 0xFFFF.
+#ifdef ARDUINO
+template <typename T> static inline void add(T &counter, T n)
+{
+    counter += n;
+}
+
+static inline void addBin(uint16_t &bin)
+{
+    if (bin != 0xFFFF) bin++;
+}
+#else
+template <typename T> static inline void add(T &counter, T n)
+{
+    __atomic_fetch_add(&counter, n, __ATOMIC_RELAXED);
+}
+
+static inline void addBin(uint16_t &bin)
+{
+    uint16_t n = __atomic_load_n(&bin, __ATOMIC_RELAXED);
+    while (n != 0xFFFF &&
+           !__atomic_compare_exchange_n(&bin, &n, n + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+template <typename T> static inline T load(T &counter)
+{
+    return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+}
+
+// Returns a copy of the statistics for a function.
+rtcOpStats_t MCP79412Instrument::stats(uint8_t op)
+{
+    rtcOpStats_t &s = m_stats[op];
+    rtcOpStats_t copy;
+
+    copy.calls = load(s.calls);
+    copy.starts = load(s.starts);
+    copy.bytesOut = load(s.bytesOut);
+    copy.bytesIn = load(s.bytesIn);
+    copy.nacks = load(s.nacks);
+    copy.polls = load(s.polls);
+    copy.micros = load(s.micros);
+    for (uint8_t i=0; i<MCP79412RTC_HIST_BINS; i++) copy.hist[i] = load(s.hist[i]);
+    return copy;
+}
+#endif
+
+// Returns the name of a counted function, e.g. "powerFail".
+const char *MCP79412Instrument::opName(uint8_t op)
+{
+    static const char * const names[RTC_OP_COUNT] = {
+        "getTime", "setTime", "read", "write",
+        "sramRead", "sramWrite", "eepromRead", "eepromWrite",
+        "calibRead", "calibWrite", "idRead", "powerFail",
+        "squareWave", "setAlarm", "enableAlarm", "alarm",
+        "out", "alarmPolarity", "isRunning", "vbaten",
+        "lastGaspSave", "lastGaspRestore", "enableEpochHint", "other"
+    };
+    return op < RTC_OP_COUNT ? names[op] : "";
+}
+
+// Zero all the statistics. On a host, calls being counted meanwhile
+// by other threads may be counted in part.
+void MCP79412Instrument::reset()
+{
+#ifdef ARDUINO
+    memset(m_stats, 0, sizeof(m_stats));
+#else
+    for (uint8_t op=0; op<RTC_OP_COUNT; op++) {
+        rtcOpStats_t &s = m_stats[op];
+        __atomic_store_n(&s.calls, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s.starts, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s.bytesOut, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s.bytesIn, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s.nacks, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s.polls, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&s.micros, 0, __ATOMIC_RELAXED);
+        for (uint8_t i=0; i<MCP79412RTC_HIST_BINS; i++) __atomic_store_n(&s.hist[i], 0, __ATOMIC_RELAXED);
+    }
+#endif
+}
+
+MCP79412Probe::MCP79412Probe(uint8_t op)
+    : m_owner(MCP79412Instrument::m_op == RTC_OP_OTHER), m_start(0)
+{
+    if (m_owner)
+    {
+        MCP79412Instrument::m_op = op;
+        m_start = MCP79412RTC_MICROS();
+    }
+}
+
+MCP79412Probe::~MCP79412Probe()
+{
+    if (!m_owner) return;
+
+    uint32_t us = MCP79412RTC_MICROS() - m_start;
+    rtcOpStats_t &s = MCP79412Instrument::current();
+    uint8_t bin = 0;
+    for (uint32_t t=us; t>1 && bin<MCP79412RTC_HIST_BINS-1; t>>=1) bin++;
+    add<uint32_t>(s.calls, 1);
+    add(s.micros, us);
+    addBin(s.hist[bin]);
+    MCP79412Instrument::m_op = RTC_OP_OTHER;
+}
+
+void MCP79412ProbeBus::begin()
+{
+    m_bus->begin();
+}
+
+void MCP79412ProbeBus::beginTransmission(uint8_t addr)
+{
+    add<uint32_t>(MCP79412Instrument::current().starts, 1);
+    m_bus->beginTransmission(addr);
+}
+
+size_t MCP79412ProbeBus::write(uint8_t value)
+{
+    size_t n = m_bus->write(value);
+    add<uint32_t>(MCP79412Instrument::current().bytesOut, n);
+    return n;
+}
+
+// An EEPROM poll is counted as a poll, as its NACK while the write is
+// in progress is expected.
+uint8_t MCP79412ProbeBus::endTransmission()
+{
+    rtcOpStats_t &s = MCP79412Instrument::current();
+    uint8_t status = m_bus->endTransmission();
+    if (MCP79412Instrument::m_polling) {
+        add<uint32_t>(s.polls, 1);
+    }
+    else if (status != 0) {
+        add<uint32_t>(s.nacks, 1);
+    }
+    return status;
+}
+
+// A read that returns fewer bytes than requested is counted as a NACK.
+uint8_t MCP79412ProbeBus::requestFrom(uint8_t addr, uint8_t nBytes)
+{
+    rtcOpStats_t &s = MCP79412Instrument::current();
+    uint8_t n = m_bus->requestFrom(addr, nBytes);
+    add<uint32_t>(s.starts, 1);
+    add<uint32_t>(s.bytesIn, n);
+    if (n < nBytes) add<uint32_t>(s.nacks, 1);
+    return n;
+}
+
+int MCP79412ProbeBus::read()
+{
+    return m_bus->read();
+}
+#endif
@@ -0,0 +1,161 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Optional instrumentation for the MCP79412RTC driver. When the
+// library is compiled with MCP79412RTC_INSTRUMENT defined, each call
+// of an MCP79412RTC function is counted, with the number of START
+// conditions, bytes written and read, NACKs, EEPROM ready-polls and
+// the time it took,
+// and a histogram of its times in powers of two microseconds. The
+// statistics are for all MCP79412RTC objects together, and are read
+// with MCP79412Instrument::stats(). Without MCP79412RTC_INSTRUMENT,
+// none of this is compiled and the driver is unchanged.
+//
+// A call is counted once, under the function called by the sketch;
+// e.g. the bus traffic of get() and of the powerFail() call made by
+// lastGaspRestore() are counted under RTC_OP_GET_TIME and
+// RTC_OP_LAST_GASP_RESTORE. Bus traffic outside any counted call
+// (begin()) is counted under RTC_OP_OTHER.
+//
+// On Arduino, the statistics are meant for a single thread of
+// execution: an RTC call from an ISR while another is being counted
+// is counted under the other call. On other platforms (e.g. the Linux
+// tools in extras/linux), calls may be made from several threads:
+// the function being counted is kept per thread, the counters are
+// updated atomically, and stats() returns a copy.
+//
+// Time is taken with MCP79412RTC_MICROS() (see MCP79412Port.h).
+// Each histogram bin is a uint16_t, so the statistics take
+// RTC_OP_COUNT * (28 + 2 * MCP79412RTC_HIST_BINS) bytes of RAM, about
+// 1.4K with the default 16 bins. To save RAM, define
+// MCP79412RTC_HIST_BINS smaller; the last bin counts all the longer
+// calls.
+
+#ifndef MCP79412INSTRUMENT_H_INCLUDED
+#define MCP79412INSTRUMENT_H_INCLUDED
+
+#include <MCP79412Bus.h>
+
+// Counted functions, for use with MCP79412Instrument::stats()
+enum {
+    RTC_OP_GET_TIME,            // get(), getTime()
+    RTC_OP_SET_TIME,            // set(), setTime()
+    RTC_OP_READ,
+    RTC_OP_WRITE,
+    RTC_OP_SRAM_READ,
+    RTC_OP_SRAM_WRITE,
+    RTC_OP_EEPROM_READ,
+    RTC_OP_EEPROM_WRITE,
+    RTC_OP_CALIB_READ,
+    RTC_OP_CALIB_WRITE,
+    RTC_OP_ID_READ,             // idRead(), getEUI64()
+    RTC_OP_POWER_FAIL,
+    RTC_OP_SQUARE_WAVE,
+    RTC_OP_SET_ALARM,
+    RTC_OP_ENABLE_ALARM,
+    RTC_OP_ALARM,               // alarm(), readAlarm()
+    RTC_OP_OUT,
+    RTC_OP_ALARM_POLARITY,
+    RTC_OP_IS_RUNNING,
+    RTC_OP_VBATEN,
+    RTC_OP_LAST_GASP_SAVE,
+    RTC_OP_LAST_GASP_RESTORE,
+    RTC_OP_EPOCH_HINT,          // enableEpochHint()
+    RTC_OP_OTHER,
+    RTC_OP_COUNT
+};
+
+#ifdef MCP79412RTC_INSTRUMENT
+
+#ifndef MCP79412RTC_HIST_BINS
+#define MCP79412RTC_HIST_BINS 16
+#endif
+
+#include <MCP79412Port.h>
+
+#ifdef ARDUINO
+#define MCP79412RTC_THREAD_LOCAL
+#else
+#define MCP79412RTC_THREAD_LOCAL thread_local
+#endif
+
+// Statistics for one function. Bin 0 of the histogram counts calls
+// that took less than 2 microseconds, bin n (n > 0) those that took
+// 2^n to 2^(n+1)-1 microseconds, and the last bin all longer calls.
+struct rtcOpStats_t {
+    uint32_t calls;             // number of calls
+    uint32_t starts;            // START (and repeated START) conditions
+    uint32_t bytesOut;          // bytes written, excluding address bytes
+    uint32_t bytesIn;           // bytes read
+    uint32_t nacks;             // transfers not acknowledged, other than polls
+    uint32_t polls;             // EEPROM polls for the end of a write, acknowledged or not
+    uint32_t micros;            // total time
+    uint16_t hist[MCP79412RTC_HIST_BINS];
+};
+
+class MCP79412Instrument
+{
+    public:
+#ifdef ARDUINO
+        static const rtcOpStats_t &stats(uint8_t op) { return m_stats[op]; }
+#else
+        static rtcOpStats_t stats(uint8_t op);
+#endif
+        static const char *opName(uint8_t op);
+        static void reset();
+        static void polling(bool on) { m_polling = on; }
+
+    private:
+        friend class MCP79412Probe;
+        friend class MCP79412ProbeBus;
+        static rtcOpStats_t &current() { return m_stats[m_op]; }
+
+        static rtcOpStats_t m_stats[RTC_OP_COUNT];
+        static MCP79412RTC_THREAD_LOCAL uint8_t m_op;   // function being counted, RTC_OP_OTHER if none
+        static MCP79412RTC_THREAD_LOCAL bool m_polling; // transactions are EEPROM polls
+};
+
+// Counts a call of a function, from construction to destruction.
+// Calls made while another call is being counted are not counted.
+class MCP79412Probe
+{
+    public:
+        MCP79412Probe(uint8_t op);
+        ~MCP79412Probe();
+
+    private:
+        bool m_owner;           // whether this probe is counting the call
+        uint32_t m_start;       // MCP79412RTC_MICROS() at construction
+};
+
+// An MCP79412Bus that counts the traffic on another bus, under the
+// function being counted.
+class MCP79412ProbeBus : public MCP79412Bus
+{
+    public:
+        constexpr MCP79412ProbeBus(MCP79412Bus *bus) : m_bus(bus) {}
+        void begin();
+        void beginTransmission(uint8_t addr);
+        size_t write(uint8_t value);
+        uint8_t endTransmission();
+        uint8_t requestFrom(uint8_t addr, uint8_t nBytes);
+        int read();
+        bool recover() { return m_bus->recover(); }
+
+    private:
+        MCP79412Bus *m_bus;     // the bus being counted
+};
+
+#define MCP79412_PROBE(op) MCP79412Probe rtcProbe(op)
+#define MCP79412_POLLING(on) MCP79412Instrument::polling(on)
+
+#else
+
+#define MCP79412_PROBE(op)
+#define MCP79412_POLLING(on)
+
+#endif
+
+#endif
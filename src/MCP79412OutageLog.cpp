@@ -0,0 +1,72 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Power outage log for the MCP7941x. See MCP79412OutageLog.h
+// for details.
+
+#include <MCP79412OutageLog.h>
+
+#define MAX_OUTAGES 16                  // outages that fit in EEPROM
+#define MAX_OUTAGE_MINUTES 0xFFFFFFUL   // largest duration that can be stored
+
+MCP79412OutageLog::MCP79412OutageLog(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_ring(rtc)
+{
+}
+
+// Define the memory used for the log: room for maxOutages outages
+// of 8 bytes each, starting at address addr in SRAM (memType ==
+// MEM_SRAM) or EEPROM (memType == MEM_EEPROM). Must be called before
+// the other functions. Returns false if the log does not fit in
+// the memory.
+bool MCP79412OutageLog::begin(byte memType, byte addr, byte maxOutages)
+{
+    return m_ring.begin(memType, addr, maxOutages);
+}
+
+// Check the RTC for a power failure, and log it if one occurred.
+// Returns true if a new outage was logged; false if there was none,
+// or it could not be logged, when lastStatus() is not RTC_OK. Note
+// that this clears the power failure in the RTC, so an outage that
+// could not be logged is lost; if the application also needs the
+// timestamps, call powerFail() (or lastGaspRestore()) instead and
+// pass the timestamps to log().
+bool MCP79412OutageLog::update()
+{
+    time_t powerDown, powerUp;
+
+    if ( m_rtc.powerFail(&powerDown, &powerUp) )
+        return log(powerDown, powerUp);
+    else
+        return false;
+}
+
+// Log an outage, overwriting the oldest one if the log is full.
+// Returns false if it could not be written (see lastStatus()).
+bool MCP79412OutageLog::log(time_t powerDown, time_t powerUp)
+{
+    uint32_t minutes = (powerUp > powerDown) ? (powerUp - powerDown) / 60 : 0;
+
+    if (minutes > MAX_OUTAGE_MINUTES) minutes = MAX_OUTAGE_MINUTES;
+    return m_ring.append(powerDown, minutes);
+}
+
+// Read the logged outages into the caller's array, oldest first.
+// If there are more than maxOutages outages, only the newest ones are
+// returned. Returns the number of outages returned.
+byte MCP79412OutageLog::read(outage_t *outages, byte maxOutages)
+{
+    uint32_t keys[MAX_OUTAGES], values[MAX_OUTAGES];
+    byte n;
+
+    if (maxOutages > MAX_OUTAGES) maxOutages = MAX_OUTAGES;
+    n = m_ring.read(keys, values, maxOutages);
+    for (byte i=0; i<n; i++) {
+        outages[i].powerDown = keys[i];
+        outages[i].duration = values[i] * 60;
+        outages[i].powerUp = outages[i].powerDown + outages[i].duration;
+    }
+    return n;
+}
@@ -0,0 +1,43 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Power outage log for the MCP7941x. Records the power down and
+// power up times captured by the RTC into a ring in the RTC's SRAM
+// or EEPROM. Each outage is stored as the power down time and the
+// duration in minutes (the RTC's timestamps have a resolution of one
+// minute), protected by a CRC. See MCP79412Ring.h for the format.
+//
+// SRAM holds up to 8 outages, EEPROM up to 16.
+
+#ifndef MCP79412OUTAGELOG_H_INCLUDED
+#define MCP79412OUTAGELOG_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <MCP79412Ring.h>
+
+// An outage as returned by read()
+struct outage_t {
+    time_t powerDown;       // power down time
+    time_t powerUp;         // power up time
+    uint32_t duration;      // outage duration in seconds
+};
+
+class MCP79412OutageLog
+{
+    public:
+        MCP79412OutageLog(MCP79412RTC &rtc);
+        bool begin(byte memType = MEM_SRAM, byte addr = 0, byte maxOutages = 8);
+        bool update();
+        bool log(time_t powerDown, time_t powerUp);
+        byte read(outage_t *outages, byte maxOutages);
+        byte count() { return m_ring.count(); }
+        bool clear() { return m_ring.clear(); }
+
+    private:
+        MCP79412RTC &m_rtc;
+        MCP79412Ring m_ring;
+};
+
+#endif
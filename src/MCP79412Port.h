@@ -0,0 +1,52 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Platform functions used by the library.
+// MCP79412RTC_MICROS() is micros() on Arduino and a monotonic clock
+// elsewhere; define it before including the library's headers to use
+// another clock. MCP79412RTC_DELAY_US(us), used to wait between
+// retries (see MCP79412RTC::setRetry()) and between EEPROM polls (see
+// MCP79412RTC::setEepromPolling()), is delayMicroseconds() on Arduino
+// and nanosleep() elsewhere; us is at most 16000.
+
+#ifndef MCP79412PORT_H_INCLUDED
+#define MCP79412PORT_H_INCLUDED
+
+#include <stdint.h>
+
+#ifndef MCP79412RTC_MICROS
+#ifdef ARDUINO
+#include <Arduino.h>
+#define MCP79412RTC_MICROS() micros()
+#else
+#include <time.h>
+inline uint32_t mcp79412Micros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+#define MCP79412RTC_MICROS() mcp79412Micros()
+#endif
+#endif
+
+#ifndef MCP79412RTC_DELAY_US
+#ifdef ARDUINO
+#include <Arduino.h>
+#define MCP79412RTC_DELAY_US(us) delayMicroseconds(us)
+#else
+#include <time.h>
+inline void mcp79412DelayUs(uint32_t us)
+{
+    struct timespec ts;
+    ts.tv_sec = us / 1000000UL;
+    ts.tv_nsec = (us % 1000000UL) * 1000;
+    nanosleep(&ts, 0);
+}
+#define MCP79412RTC_DELAY_US(us) mcp79412DelayUs(us)
+#endif
+#endif
+
+#endif
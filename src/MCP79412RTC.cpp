@@ -8,25 +8,29 @@
 // https://playground.arduino.cc/Code/Time
 // https://github.com/PaulStoffregen/Time
 //
-// For AVR architecture, an MCP79412RTC object named RTC is instantiated
-// by the library and I2C initialization occurs in the constructor;
-// this is for backwards compatibility.
-// For other architectures, the user needs to instantiate a MCP79412RTC
-// object and optionally initialize the I2C bus by calling
-// MCP79412RTC::begin(). The constructor has an optional bool parameter
-// to indicate whether I2C initialization should occur in the
-// constructor; this parameter defaults to true if not given.
+// An MCP79412RTC object named RTC is instantiated by the library. Its
+// constructor is constexpr, so it does nothing at run time; the I2C
+// bus is initialized by begin(), or otherwise on the first transaction
+// with the RTC. The constructors that take initI2C initialize the bus
+// at once when it is true, as the RTC object used to.
+//
+// Each MCP79412RTC object talks to its RTC through an MCP79412Bus
+// (see MCP79412Bus.h); by default this is the platform's I2C bus.
+// To use several RTCs, e.g. on separate buses or behind an I2C
+// multiplexer, instantiate an MCP79412RTC object for each, passing
+// its bus to the constructor. The static get() and set() functions,
+// as used with setSyncProvider(), operate on the default RTC, which
+// is the RTC object unless changed with setDefault().
 
 #include <MCP79412RTC.h>
+#include <MCP79412Port.h>
 #include <stdlib.h>
-#include "i2c.h"
 
-#define i2cBegin i2c.begin
-#define i2cBeginTransmission i2c.beginTransmission
-#define i2cEndTransmission i2c.endTransmission
-#define i2cRequestFrom i2c.requestFrom
-#define i2cRead i2c.read
-#define i2cWrite i2c.write
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
+MCP79412RTC *MCP79412RTC::m_default = &RTC;
+#else
+MCP79412RTC *MCP79412RTC::m_default = 0;
+#endif
 
 // MCP7941x I2C Addresses
 #define RTC_ADDR 0x6F
@@ -35,6 +39,8 @@
 // MCP7941x Register Addresses
 #define TIME_REG 0x00        // 7 registers, Seconds, Minutes, Hours, DOW, Date, Month, Year
 #define DAY_REG 0x03         // the RTC Day register contains the OSCON, VBAT, and VBATEN bits
+#define DATE_REG 0x04        // RTC date register
+#define MONTH_REG 0x05       // RTC month register
 #define YEAR_REG 0x06        // RTC year register
 #define CTRL_REG 0x07        // control register
 #define CALIB_REG 0x08       // calibration register
@@ -51,6 +57,13 @@
 #define EEPROM_PAGE_SIZE 8   // number of bytes on an EEPROM page
 #define UNIQUE_ID_ADDR 0xF0  // starting address for unique ID
 #define UNIQUE_ID_SIZE 8     // number of bytes in unique ID
+#define LAST_GASP_MAGIC 0xA5 // XORed with the state bytes to form the last-gasp check byte
+#define HINT_SIZE 3          // epoch hint in SRAM: days since 1970 (2), CRC (1)
+#define HINT_INVALID 0xFFFF  // m_hintDays when the hint in SRAM is not valid
+#define MAX_BACKOFF_US 16000 // longest wait between retries
+#define MIN_POLL_US 50       // shortest adaptive polling interval
+#define MAX_WRITE_US 16000   // longest expected EEPROM write time, as MCP79412RTC_DELAY_US() takes at most 16000
+#define EDGE_TIMEOUT_US 1100000UL   // longest wait for the seconds to change
 
 // Control Register bits
 #define OUT 7       // sets logic level on MFP when not used as square wave output
@@ -79,24 +92,63 @@
 #define ALMC0 4
 #define ALMIF 3     // Alarm Interrupt Flag: Set by hardware when an alarm was triggered, cleared by software.
 
-// Constructor. Initializes the I2C bus by default, but better
-// practice is to pass false in the constructor and call
-// the begin() function in the setup code.
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
+// Constructor for the legacy MCP79412RTC(true) and MCP79412RTC(false).
+// Initializes the I2C bus now if initI2C is true; otherwise it is
+// initialized by begin(), or on first use.
 MCP79412RTC::MCP79412RTC(bool initI2C)
+    : MCP79412RTC()
+{
+    if (initI2C) begin();
+}
+#endif
+
+// Constructor for an RTC on a given bus, e.g. a second I2C bus, or
+// a channel of an I2C multiplexer (see MCP79412Bus.h), that
+// initializes the bus now if initI2C is true.
+MCP79412RTC::MCP79412RTC(MCP79412Bus &bus, bool initI2C)
+    : MCP79412RTC(bus)
 {
-    if (initI2C) i2cBegin();
+    if (initI2C) begin();
 }
 
-// Initialize the I2C bus.
+// Initialize the I2C bus. Calling this is optional, as the bus is
+// initialized on the first transaction otherwise, but it is better
+// practice to call it in the setup code.
 void MCP79412RTC::begin()
 {
-    i2cBegin();
+    io()->begin();
+    m_begun = true;
+}
+
+// Read the current time from the default RTC (normally the RTC
+// object) and return it as a time_t value. This is a static function
+// so that it can be passed to the Time library's setSyncProvider();
+// to read the time from another RTC object, use its getTime().
+time_t MCP79412RTC::get()
+{
+    return m_default->getTime();
+}
+
+// Set the default RTC (normally the RTC object) to the given time_t
+// value. To set another RTC object, use its setTime().
+void MCP79412RTC::set(time_t t)
+{
+    m_default->setTime(t);
+}
+
+// Make this RTC the default RTC, i.e. the one used by the static
+// functions get() and set(), and so by setSyncProvider(RTC.get).
+void MCP79412RTC::setDefault()
+{
+    m_default = this;
 }
 
 // Read the current time from the RTC and return it as a time_t value.
 // Returns a zero value if RTC not present (I2C I/O error).
-time_t MCP79412RTC::get()
+time_t MCP79412RTC::getTime()
 {
+    MCP79412_PROBE(RTC_OP_GET_TIME);
     tmElements_t tm;
 
     if ( read(tm) )
@@ -105,84 +157,195 @@ time_t MCP79412RTC::get()
         return 0;
 }
 
+// Wait for the RTC's seconds to change, by reading the time until they
+// do, and return the new time in *t. If clock is given, it is called
+// with ctx around each read, e.g. to read a counter or a reference
+// clock, and *before is set to its value before the last read of the
+// old time, *after to its value after the first read of the new, so
+// the change happened between them. Takes up to a second. Returns
+// false if the RTC does not respond or its time does not change.
+bool MCP79412RTC::waitSecond(time_t *t, uint32_t (*clock)(void *ctx), void *ctx,
+    uint32_t *before, uint32_t *after)
+{
+    uint32_t start = MCP79412RTC_MICROS();
+    uint32_t last = clock ? clock(ctx) : 0;
+    uint32_t b = 0, a = 0;
+    time_t t0 = getTime();
+
+    if (m_status != RTC_OK) return false;
+    while (MCP79412RTC_MICROS() - start < EDGE_TIMEOUT_US) {
+        if (clock) b = clock(ctx);
+        *t = getTime();
+        if (clock) a = clock(ctx);
+        if (m_status != RTC_OK) return false;
+        if (*t != t0) {
+            if (before) *before = last;
+            if (after) *after = a;
+            return true;
+        }
+        last = b;
+    }
+    return false;
+}
+
 // Set the RTC to the given time_t value.
-void MCP79412RTC::set(time_t t)
+rtcStatus_t MCP79412RTC::setTime(time_t t)
 {
+    MCP79412_PROBE(RTC_OP_SET_TIME);
     tmElements_t tm;
 
     breakTime(t, tm);
-    write(tm);
+    return write(tm);
 }
 
 // Read the current time from the RTC and return it in a tmElements_t
-// structure. Returns false if RTC not present (I2C I/O error).
+// structure. Returns false if RTC not present (I2C I/O error); see
+// lastStatus() for the reason.
 bool MCP79412RTC::read(tmElements_t &tm)
 {
-    i2cBeginTransmission(RTC_ADDR);
-    i2cWrite((uint8_t)TIME_REG);
-    if (i2cEndTransmission() != 0) {
-        return false;
+    MCP79412_PROBE(RTC_OP_READ);
+    byte regs[tmNbrFields];     // secs, min, hr, dow, date, mth, yr
+
+    if (readRegs(RTC_ADDR, TIME_REG, regs, tmNbrFields) != RTC_OK) return false;
+    tm.Second = bcd2dec(regs[0] & ~_BV(ST));
+    tm.Minute = bcd2dec(regs[1]);
+    tm.Hour = bcd2dec(regs[2] & ~_BV(HR1224));      // assumes 24hr clock
+    byte day = regs[3];
+    tm.Wday = day & ~(_BV(OSCON) | _BV(VBAT) | _BV(VBATEN));    // mask off OSCON, VBAT, VBATEN bits
+    tm.Day = bcd2dec(regs[4]);
+    tm.Month = bcd2dec(regs[5] & ~_BV(LP));         // mask off the leap year bit
+    tm.Year = y2kYearToTm(bcd2dec(regs[6]));
+    // don't move the epoch hint past a power failure that powerFail() has yet to see
+    if (m_hintAddr < SRAM_SIZE && !(day & _BV(VBAT))) updateEpochHint(makeTime(tm) / SECS_PER_DAY);
+    return true;
+}
+
+// Set the RTC's time from a tmElements_t structure. The oscillator
+// is stopped while the registers are written and started again with
+// the seconds; if the second write fails, the RTC is left stopped
+// (see isRunning()).
+rtcStatus_t MCP79412RTC::write(tmElements_t &tm)
+{
+    MCP79412_PROBE(RTC_OP_WRITE);
+    byte regs[tmNbrFields];
+
+    regs[0] = 0x00;                             // stops the oscillator (Bit 7, ST == 0)
+    regs[1] = dec2bcd(tm.Minute);
+    regs[2] = dec2bcd(tm.Hour);                 // sets 24 hour format (Bit 6 == 0)
+    regs[3] = tm.Wday | _BV(VBATEN);            // enable battery backup operation
+    regs[4] = dec2bcd(tm.Day);
+    regs[5] = dec2bcd(tm.Month);
+    regs[6] = dec2bcd(tmYearToY2k(tm.Year));
+    if (writeRegs(RTC_ADDR, TIME_REG, regs, tmNbrFields) != RTC_OK) return m_status;
+
+    regs[0] = dec2bcd(tm.Second) | _BV(ST);     // set the seconds and start the oscillator (Bit 7, ST == 1)
+    if (writeRegs(RTC_ADDR, TIME_REG, regs, 1) != RTC_OK) return m_status;
+
+    if (m_hintAddr < SRAM_SIZE) updateEpochHint(makeTime(tm) / SECS_PER_DAY);
+    return m_status;
+}
+
+// Returns the status of the last operation, RTC_OK if it succeeded.
+// Useful for the functions that return a value rather than a status,
+// e.g. sramRead(addr) or calibRead().
+rtcStatus_t MCP79412RTC::lastStatus()
+{
+    return m_status;
+}
+
+// Set the retry policy for bus transactions. A transaction that fails
+// (e.g. is not acknowledged because of contention on the bus) is
+// retried up to retries times, waiting backoffUs microseconds before
+// the first retry and doubling the wait before each further retry, up
+// to 16ms. The default is no retries. A read-modify-write operation is
+// never written back when its read fails.
+void MCP79412RTC::setRetry(byte retries, uint16_t backoffUs)
+{
+    m_retries = retries;
+    m_backoffUs = backoffUs;
+}
+
+// Write nBytes to consecutive registers of the device at devAddr,
+// starting at register reg, in one transaction, with retries as set
+// by setRetry(). Number of bytes (nBytes) must be between 0 and 31
+// (Wire library limitation).
+rtcStatus_t MCP79412RTC::writeRegs(byte devAddr, byte reg, const byte *values, byte nBytes)
+{
+    for (byte attempt=0; ; attempt++) {
+        bus()->beginTransmission(devAddr);
+        io()->write(reg);
+        for (byte i=0; i<nBytes; i++) io()->write(values[i]);
+        m_status = busStatus(io()->endTransmission());
+        if (m_status == RTC_OK || !retryWait(attempt)) return m_status;
     }
-    else {
-        // request 7 bytes (secs, min, hr, dow, date, mth, yr)
-        i2cRequestFrom(RTC_ADDR, tmNbrFields);
-        tm.Second = bcd2dec(i2cRead() & ~_BV(ST));
-        tm.Minute = bcd2dec(i2cRead());
-        tm.Hour = bcd2dec(i2cRead() & ~_BV(HR1224));    // assumes 24hr clock
-        tm.Wday = i2cRead() & ~(_BV(OSCON) | _BV(VBAT) | _BV(VBATEN));    // mask off OSCON, VBAT, VBATEN bits
-        tm.Day = bcd2dec(i2cRead());
-        tm.Month = bcd2dec(i2cRead() & ~_BV(LP));       // mask off the leap year bit
-        tm.Year = y2kYearToTm(bcd2dec(i2cRead()));
-        return true;
+}
+
+// Read nBytes from consecutive registers of the device at devAddr,
+// starting at register reg: one transaction to set the register
+// pointer and one to read, retried together as set by setRetry().
+// Number of bytes (nBytes) must be between 1 and 32 (Wire library
+// limitation). If the read fails, the contents of values are
+// undefined.
+rtcStatus_t MCP79412RTC::readRegs(byte devAddr, byte reg, byte *values, byte nBytes)
+{
+    for (byte attempt=0; ; attempt++) {
+        bus()->beginTransmission(devAddr);
+        io()->write(reg);
+        m_status = busStatus(io()->endTransmission());
+        if (m_status == RTC_OK) {
+            byte n = bus()->requestFrom(devAddr, nBytes);
+            for (byte i=0; i<n && i<nBytes; i++) values[i] = io()->read();
+            if (n < nBytes) m_status = (n == 0) ? RTC_ADDR_NACK : RTC_SHORT_READ;
+        }
+        if (m_status == RTC_OK || !retryWait(attempt)) return m_status;
     }
 }
 
-// Set the RTC's time from a tmElements_t structure.
-void MCP79412RTC::write(tmElements_t &tm)
+// Wait before retrying a failed transaction. Returns false, without
+// waiting, if the given attempt (0 for the first) was the last.
+bool MCP79412RTC::retryWait(byte attempt)
 {
-    i2cBeginTransmission(RTC_ADDR);
-    i2cWrite((uint8_t)TIME_REG);
-    i2cWrite((uint8_t)0x00);                     // stops the oscillator (Bit 7, ST == 0)
-    i2cWrite(dec2bcd(tm.Minute));
-    i2cWrite(dec2bcd(tm.Hour));                  // sets 24 hour format (Bit 6 == 0)
-    i2cWrite(tm.Wday | _BV(VBATEN));             // enable battery backup operation
-    i2cWrite(dec2bcd(tm.Day));
-    i2cWrite(dec2bcd(tm.Month));
-    i2cWrite(dec2bcd(tmYearToY2k(tm.Year)));
-    i2cEndTransmission();
+    if (attempt >= m_retries) return false;
+    uint32_t us = (uint32_t)m_backoffUs << (attempt < 8 ? attempt : 8);
+    MCP79412RTC_DELAY_US(us < MAX_BACKOFF_US ? us : MAX_BACKOFF_US);
+    return true;
+}
 
-    i2cBeginTransmission(RTC_ADDR);
-    i2cWrite((uint8_t)TIME_REG);
-    i2cWrite(dec2bcd(tm.Second) | _BV(ST));    // set the seconds and start the oscillator (Bit 7, ST == 1)
-    i2cEndTransmission();
+// Convert an endTransmission() return value to a status code.
+rtcStatus_t MCP79412RTC::busStatus(uint8_t txStatus)
+{
+    switch (txStatus) {
+        case 0: return RTC_OK;
+        case 2: return RTC_ADDR_NACK;
+        case 3: return RTC_DATA_NACK;
+        default: return RTC_BUS_ERROR;
+    }
 }
 
 // Write a single byte to RTC RAM.
 // Valid address range is 0x00 - 0x5F, no checking.
-void MCP79412RTC::ramWrite(byte addr, byte value)
+rtcStatus_t MCP79412RTC::ramWrite(byte addr, byte value)
 {
-    ramWrite(addr, &value, 1);
+    return writeRegs(RTC_ADDR, addr, &value, 1);
 }
 
 // Write multiple bytes to RTC RAM.
 // Valid address range is 0x00 - 0x5F, no checking.
 // Number of bytes (nBytes) must be between 1 and 31 (Wire library
 // limitation).
-void MCP79412RTC::ramWrite(byte addr, byte *values, byte nBytes)
+rtcStatus_t MCP79412RTC::ramWrite(byte addr, byte *values, byte nBytes)
 {
-    i2cBeginTransmission(RTC_ADDR);
-    i2cWrite(addr);
-    for (byte i=0; i<nBytes; i++) i2cWrite(values[i]);
-    i2cEndTransmission();
+    return writeRegs(RTC_ADDR, addr, values, nBytes);
 }
 
 // Read a single byte from RTC RAM.
 // Valid address range is 0x00 - 0x5F, no checking.
+// Returns zero if the read fails.
 byte MCP79412RTC::ramRead(byte addr)
 {
     byte value;
 
-    ramRead(addr, &value, 1);
+    if (readRegs(RTC_ADDR, addr, &value, 1) != RTC_OK) value = 0;
     return value;
 }
 
@@ -190,20 +353,17 @@ byte MCP79412RTC::ramRead(byte addr)
 // Valid address range is 0x00 - 0x5F, no checking.
 // Number of bytes (nBytes) must be between 1 and 32 (Wire library
 // limitation).
-void MCP79412RTC::ramRead(byte addr, byte *values, byte nBytes)
+rtcStatus_t MCP79412RTC::ramRead(byte addr, byte *values, byte nBytes)
 {
-    i2cBeginTransmission(RTC_ADDR);
-    i2cWrite(addr);
-    i2cEndTransmission();
-    i2cRequestFrom( (uint8_t)RTC_ADDR, nBytes );
-    for (byte i=0; i<nBytes; i++) values[i] = i2cRead();
+    return readRegs(RTC_ADDR, addr, values, nBytes);
 }
 
 // Write a single byte to Static RAM.
 // Address (addr) is constrained to the range (0, 63).
-void MCP79412RTC::sramWrite(byte addr, byte value)
+rtcStatus_t MCP79412RTC::sramWrite(byte addr, byte value)
 {
-    ramWrite( (addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR, &value, 1 );
+    MCP79412_PROBE(RTC_OP_SRAM_WRITE);
+    return ramWrite( (addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR, &value, 1 );
 }
 
 // Write multiple bytes to Static RAM.
@@ -212,26 +372,27 @@ void MCP79412RTC::sramWrite(byte addr, byte value)
 // limitation).
 // Invalid values for nBytes, or combinations of addr and nBytes
 // that would result in addressing past the last byte of SRAM will
-// result in no action.
-void MCP79412RTC::sramWrite(byte addr, byte *values, byte nBytes)
+// result in no action, and RTC_BAD_ARG is returned.
+rtcStatus_t MCP79412RTC::sramWrite(byte addr, byte *values, byte nBytes)
 {
+    MCP79412_PROBE(RTC_OP_SRAM_WRITE);
 #if defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
     if (nBytes >= 1 && (addr + nBytes) <= SRAM_SIZE) {
 #else
     if (nBytes >= 1 && nBytes <= (BUFFER_LENGTH - 1) && (addr + nBytes) <= SRAM_SIZE) {
 #endif
-        ramWrite( (addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR, values, nBytes );
+        return ramWrite( (addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR, values, nBytes );
     }
+    return m_status = RTC_BAD_ARG;
 }
 
 // Read a single byte from Static RAM.
 // Address (addr) is constrained to the range (0, 63).
+// Returns zero if the read fails; see lastStatus().
 byte MCP79412RTC::sramRead(byte addr)
 {
-    byte value;
-
-    ramRead( (addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR, &value, 1 );
-    return value;
+    MCP79412_PROBE(RTC_OP_SRAM_READ);
+    return ramRead( (addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR );
 }
 
 // Read multiple bytes from Static RAM.
@@ -240,54 +401,56 @@ byte MCP79412RTC::sramRead(byte addr)
 // limitation).
 // Invalid values for nBytes, or combinations of addr and
 // nBytes that would result in addressing past the last byte of SRAM
-// result in no action.
-void MCP79412RTC::sramRead(byte addr, byte *values, byte nBytes)
+// result in no action, and RTC_BAD_ARG is returned.
+rtcStatus_t MCP79412RTC::sramRead(byte addr, byte *values, byte nBytes)
 {
+    MCP79412_PROBE(RTC_OP_SRAM_READ);
 #if defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
     if (nBytes >= 1 && (addr + nBytes) <= SRAM_SIZE) {
 #else
     if (nBytes >= 1 && nBytes <= BUFFER_LENGTH && (addr + nBytes) <= SRAM_SIZE) {
 #endif
-        ramRead((addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR, values, nBytes);
+        return ramRead((addr & (SRAM_SIZE - 1) ) + SRAM_START_ADDR, values, nBytes);
     }
+    return m_status = RTC_BAD_ARG;
 }
 
 // Write a single byte to EEPROM.
 // Address (addr) is constrained to the range (0, 127).
 // Can't leverage page write function because a write can't start
 // mid-page.
-void MCP79412RTC::eepromWrite(byte addr, byte value)
+rtcStatus_t MCP79412RTC::eepromWrite(byte addr, byte value)
 {
-    i2cBeginTransmission(EEPROM_ADDR);
-    i2cWrite( addr & (EEPROM_SIZE - 1) );
-    i2cWrite(value);
-    i2cEndTransmission();
-    eepromWait();
+    MCP79412_PROBE(RTC_OP_EEPROM_WRITE);
+    if (writeRegs(EEPROM_ADDR, addr & (EEPROM_SIZE - 1), &value, 1) == RTC_OK) eepromWait();
+    return m_status;
 }
 
 // Write a page (or less) to EEPROM. An EEPROM page is 8 bytes.
 // Address (addr) should be a page start address (0, 8, ..., 120), but
 // is ruthlessly coerced into a valid value.
 // Number of bytes (nBytes) must be between 1 and 8, other values
-// result in no action.
-void MCP79412RTC::eepromWrite(byte addr, byte *values, byte nBytes)
+// result in no action, and RTC_BAD_ARG is returned.
+rtcStatus_t MCP79412RTC::eepromWrite(byte addr, byte *values, byte nBytes)
 {
+    MCP79412_PROBE(RTC_OP_EEPROM_WRITE);
     if (nBytes >= 1 && nBytes <= EEPROM_PAGE_SIZE) {
-        i2cBeginTransmission(EEPROM_ADDR);
-        i2cWrite( addr & ~(EEPROM_PAGE_SIZE - 1) & (EEPROM_SIZE - 1) );
-        for (byte i=0; i<nBytes; i++) i2cWrite(values[i]);
-        i2cEndTransmission();
-        eepromWait();
+        if (writeRegs(EEPROM_ADDR, addr & ~(EEPROM_PAGE_SIZE - 1) & (EEPROM_SIZE - 1), values, nBytes) == RTC_OK)
+            eepromWait();
+        return m_status;
     }
+    return m_status = RTC_BAD_ARG;
 }
 
 // Read a single byte from EEPROM.
 // Address (addr) is constrained to the range (0, 127).
+// Returns zero if the read fails; see lastStatus().
 byte MCP79412RTC::eepromRead(byte addr)
 {
+    MCP79412_PROBE(RTC_OP_EEPROM_READ);
     byte value;
 
-    eepromRead( addr & (EEPROM_SIZE - 1), &value, 1 );
+    if (readRegs(EEPROM_ADDR, addr & (EEPROM_SIZE - 1), &value, 1) != RTC_OK) value = 0;
     return value;
 }
 
@@ -297,46 +460,101 @@ byte MCP79412RTC::eepromRead(byte addr)
 // limitation).
 // Invalid values for addr or nBytes, or combinations of addr and
 // nBytes that would result in addressing past the last byte of EEPROM
-// result in no action.
-void MCP79412RTC::eepromRead(byte addr, byte *values, byte nBytes)
+// result in no action, and RTC_BAD_ARG is returned.
+rtcStatus_t MCP79412RTC::eepromRead(byte addr, byte *values, byte nBytes)
 {
+    MCP79412_PROBE(RTC_OP_EEPROM_READ);
 #if defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
     if (nBytes >= 1 && (addr + nBytes) <= EEPROM_SIZE) {
 #else
     if (nBytes >= 1 && nBytes <= BUFFER_LENGTH && (addr + nBytes) <= EEPROM_SIZE) {
 #endif
-        i2cBeginTransmission(EEPROM_ADDR);
-        i2cWrite( addr & (EEPROM_SIZE - 1) );
-        i2cEndTransmission();
-        i2cRequestFrom( (uint8_t)EEPROM_ADDR, nBytes );
-        for (byte i=0; i<nBytes; i++) values[i] = i2cRead();
+        return readRegs(EEPROM_ADDR, addr & (EEPROM_SIZE - 1), values, nBytes);
     }
+    return m_status = RTC_BAD_ARG;
 }
 
-// Wait for EEPROM write to complete.
-byte MCP79412RTC::eepromWait()
+// Wait for EEPROM write to complete. The EEPROM does not acknowledge
+// its address while the write is in progress, so these NACKs are
+// expected and are not retried or reported. If it has not acknowledged
+// by the EEPROM timeout (see setEepromTimeout()), the device is taken
+// to be missing or stuck: the bus is recovered if it supports it (see
+// MCP79412Bus::recover()), and RTC_TIMEOUT is returned.
+//
+// With EEPROM_POLL_FAST, the EEPROM is polled back-to-back. With
+// EEPROM_POLL_ADAPTIVE, the bus is left idle for 7/8 of the expected
+// write time, then polled every 1/16 of it; the expected write time
+// is a moving average of the times measured, starting at the 5ms
+// maximum, and limited to 16ms so that the waits are within what
+// MCP79412RTC_DELAY_US() takes.
+rtcStatus_t MCP79412RTC::eepromWait()
 {
-    byte waitCount = 0;
-    byte txStatus;
+    uint32_t start = MCP79412RTC_MICROS();
+    uint32_t timeout = (uint32_t)m_eepromTimeoutMs * 1000;
+    uint32_t elapsed;
+    bool adaptive = (m_pollMode == EEPROM_POLL_ADAPTIVE);
 
+    if (adaptive) MCP79412RTC_DELAY_US(m_writeUs - m_writeUs / 8);
+    m_waitCount = 0;
     do
     {
-        ++waitCount;
-        i2cBeginTransmission(EEPROM_ADDR);
-        i2cWrite((uint8_t)0);
-        txStatus = i2cEndTransmission();
+        if (m_waitCount < 0xFFFF) ++m_waitCount;
+        bus()->beginTransmission(EEPROM_ADDR);
+        io()->write((uint8_t)0);
+        MCP79412_POLLING(true);
+        uint8_t status = io()->endTransmission();
+        MCP79412_POLLING(false);
+        if (status == 0) {
+            if (adaptive) {
+                elapsed = MCP79412RTC_MICROS() - start;
+                if (elapsed > MAX_WRITE_US) elapsed = MAX_WRITE_US;
+                m_writeUs += ((int32_t)elapsed - (int32_t)m_writeUs) / 4;
+            }
+            return m_status = RTC_OK;
+        }
+        if (adaptive) {
+            uint16_t interval = m_writeUs / 16;
+            MCP79412RTC_DELAY_US(interval > MIN_POLL_US ? interval : MIN_POLL_US);
+        }
+    } while (MCP79412RTC_MICROS() - start < timeout);
+
+    io()->recover();
+    return m_status = RTC_TIMEOUT;
+}
+
+// Set how eepromWait() polls the EEPROM for the completion of a write:
+// EEPROM_POLL_FAST (the default) polls continuously, for the lowest
+// latency; EEPROM_POLL_ADAPTIVE waits for most of the expected write
+// time first and then polls at intervals, leaving the bus free for
+// other devices during the write.
+void MCP79412RTC::setEepromPolling(uint8_t mode)
+{
+    m_pollMode = mode;
+}
 
-    } while (txStatus != 0);
+// Set the longest time to wait for an EEPROM write to complete, in
+// milliseconds. The EEPROM's write cycle is 5ms at most; the default
+// is 10ms.
+void MCP79412RTC::setEepromTimeout(uint16_t timeoutMs)
+{
+    m_eepromTimeoutMs = timeoutMs;
+}
 
-    return waitCount;
+// Returns the number of times the EEPROM was polled for the completion
+// of the last write, including the poll that it acknowledged.
+uint16_t MCP79412RTC::eepromWaitCount()
+{
+    return m_waitCount;
 }
 
 // Read the calibration register.
 // The calibration value is not a twos-complement number. The MSB is
 // the sign bit, and the 7 LSBs are an unsigned number, so we convert
 // it and return it to the caller as a regular twos-complement integer.
+// Returns zero if the read fails; see lastStatus().
 int MCP79412RTC::calibRead()
 {
+    MCP79412_PROBE(RTC_OP_CALIB_READ);
     byte val = ramRead(CALIB_REG);
 
     if ( val & 0x80 ) return -(val & 0x7F);
@@ -345,40 +563,42 @@ int MCP79412RTC::calibRead()
 
 // Write the calibration register.
 // Calibration value must be between -127 and 127, others result
-// in no action. See note above on the format of the calibration value.
-void MCP79412RTC::calibWrite(int value)
+// in no action, and RTC_BAD_ARG is returned. See note above on the
+// format of the calibration value.
+rtcStatus_t MCP79412RTC::calibWrite(int value)
 {
+    MCP79412_PROBE(RTC_OP_CALIB_WRITE);
     byte calibVal;
 
     if (value >= -127 && value <= 127) {
         calibVal = abs(value);
         if (value < 0) calibVal += 128;
-        ramWrite(CALIB_REG, calibVal);
+        return ramWrite(CALIB_REG, calibVal);
     }
+    return m_status = RTC_BAD_ARG;
 }
 
 // Read the unique ID.
 // For the MCP79411 (EUI-48), the first two bytes will contain 0xFF.
 // Caller must provide an 8-byte array to contain the results.
-void MCP79412RTC::idRead(byte *uniqueID)
+rtcStatus_t MCP79412RTC::idRead(byte *uniqueID)
 {
-    i2cBeginTransmission(EEPROM_ADDR);
-    i2cWrite(UNIQUE_ID_ADDR);
-    i2cEndTransmission();
-    i2cRequestFrom( EEPROM_ADDR, UNIQUE_ID_SIZE );
-    for (byte i=0; i<UNIQUE_ID_SIZE; i++) uniqueID[i] = i2cRead();
+    MCP79412_PROBE(RTC_OP_ID_READ);
+    return readRegs(EEPROM_ADDR, UNIQUE_ID_ADDR, uniqueID, UNIQUE_ID_SIZE);
 }
 
 // Returns an EUI-64 ID. For an MCP79411, the EUI-48 ID is converted to
 // EUI-64. For an MCP79412, calling this function is equivalent to
 // calling idRead(). For an MCP79412, if the RTC type is known, calling
 // idRead() will be a bit more efficient.
-// Caller must provide an 8-byte array to contain the results.
-void MCP79412RTC::getEUI64(byte *uniqueID)
+// Caller must provide an 8-byte array to contain the results, which
+// are not changed if the read fails.
+rtcStatus_t MCP79412RTC::getEUI64(byte *uniqueID)
 {
+    MCP79412_PROBE(RTC_OP_ID_READ);
     byte rtcID[8];
 
-    idRead(rtcID);
+    if (idRead(rtcID) != RTC_OK) return m_status;
     if (rtcID[0] == 0xFF && rtcID[1] == 0xFF) {
         rtcID[0] = rtcID[2];
         rtcID[1] = rtcID[3];
@@ -387,6 +607,7 @@ void MCP79412RTC::getEUI64(byte *uniqueID)
         rtcID[4] = 0xFE;
     }
     for (byte i=0; i<UNIQUE_ID_SIZE; i++) uniqueID[i] = rtcID[i];
+    return m_status;
 }
 
 // Check to see if a power failure has occurred. If so, returns TRUE
@@ -396,47 +617,50 @@ void MCP79412RTC::getEUI64(byte *uniqueID)
 // failure is reset.
 //
 // Note that the power down and power up timestamp registers do not
-// contain values for seconds or for the year. The returned time stamps
-// will therefore contain the current year from the RTC. However, there
-// is a chance that a power outage spans from one year to the next.
-// If we find the power down timestamp to be later (larger) than the
-// power up timestamp, we will assume this has happened, and
-// subtract one year from the power down timestamp.
+// contain values for seconds or for the year, so the year must be
+// inferred.
+//
+// If an epoch hint has been enabled (see enableEpochHint()), the
+// hint gives the last day on which the MCU was known to be running.
+// The power down time is taken to be the first time on or after that
+// day that matches the timestamp, and the power up time to be the
+// last time no later than today that matches its timestamp. This
+// gives the correct years even for an outage spanning several years.
 //
-// Still, there is an assumption that the timestamps are being read
-// in the same year as that when the power up occurred.
+// Without an epoch hint, the returned time stamps will contain the
+// current year from the RTC. However, there is a chance that a power
+// outage spans from one year to the next. If we find the power down
+// timestamp to be later (larger) than the power up timestamp, we will
+// assume this has happened, and subtract one year from the power
+// down timestamp. Still, there is an assumption that the timestamps
+// are being read in the same year as that when the power up occurred.
+//
+// The Day, Date, Month and Year registers and both timestamps are
+// read in a single 29-byte transaction.
 //
 // Finally, note that once the RTC records a power outage, it must be
-// cleared before another will be recorded.
+// cleared before another will be recorded. If the registers cannot be
+// read, false is returned; see lastStatus(). If the VBAT bit cannot
+// then be cleared, true is still returned, and the same power failure
+// will be seen again by the next call.
 bool MCP79412RTC::powerFail(time_t *powerDown, time_t *powerUp)
 {
-    byte day, yr;                   // copies of the RTC Day and Year registers
-    tmElements_t dn, up;            // power down and power up times
+    MCP79412_PROBE(RTC_OP_POWER_FAIL);
+    byte regs[PWRUP_TS_REG + TIMESTAMP_SIZE / 2 - DAY_REG];    // Day register through the power up timestamp
+    byte day;                       // copy of the RTC Day register
+    tmElements_t dn, up, today;     // power down and power up times, and today's date
 
-    ramRead(DAY_REG, &day, 1);
-    ramRead(YEAR_REG, &yr, 1);
-    yr = y2kYearToTm(bcd2dec(yr));
+    if (ramRead(DAY_REG, regs, sizeof(regs)) != RTC_OK) return false;
+    day = regs[0];
     if ( day & _BV(VBAT) ) {
-        i2cBeginTransmission(RTC_ADDR);
-        i2cWrite(PWRDWN_TS_REG);
-        i2cEndTransmission();
-
-        i2cRequestFrom(RTC_ADDR, TIMESTAMP_SIZE);     // read both timestamp registers, 8 bytes total
-        dn.Second = 0;
-        dn.Minute = bcd2dec(i2cRead());
-        dn.Hour = bcd2dec(i2cRead() & ~_BV(HR1224));    // assumes 24hr clock
-        dn.Day = bcd2dec(i2cRead());
-        dn.Month = bcd2dec(i2cRead() & 0x1F);           // mask off the day, we don't need it
-        dn.Year = yr;                                   // assume current year
-        up.Second = 0;
-        up.Minute = bcd2dec(i2cRead());
-        up.Hour = bcd2dec(i2cRead() & ~_BV(HR1224));    // assumes 24hr clock
-        up.Day = bcd2dec(i2cRead());
-        up.Month = bcd2dec(i2cRead() & 0x1F);           // mask off the day, we don't need it
-        up.Year = yr;                                   // assume current year
-
-        *powerDown = makeTime(dn);
-        *powerUp = makeTime(up);
+        today.Second = 0;
+        today.Minute = 0;
+        today.Hour = 0;
+        today.Day = bcd2dec(regs[DATE_REG - DAY_REG]);
+        today.Month = bcd2dec(regs[MONTH_REG - DAY_REG] & ~_BV(LP));
+        today.Year = y2kYearToTm(bcd2dec(regs[YEAR_REG - DAY_REG]));
+        readTimestamp(&regs[PWRDWN_TS_REG - DAY_REG], dn);
+        readTimestamp(&regs[PWRUP_TS_REG - DAY_REG], up);
 
         // clear the VBAT bit, which causes the RTC hardware to clear the timestamps too.
         // I suppose there is a risk here that the day has changed since we read it,
@@ -449,83 +673,178 @@ bool MCP79412RTC::powerFail(time_t *powerDown, time_t *powerUp)
         day &= ~_BV(VBAT);
         ramWrite(DAY_REG, &day , 1);
 
-        // adjust the powerDown timestamp if needed (see notes above)
-        if (*powerDown > *powerUp) {
-            --dn.Year;
+        uint16_t todayDays = makeTime(today) / SECS_PER_DAY;
+        if (m_hintAddr < SRAM_SIZE && m_hintDays != HINT_INVALID && m_hintDays <= todayDays) {
+            // the power down was on or after the hint day
+            tmElements_t hint;
+            breakTime((time_t)m_hintDays * SECS_PER_DAY, hint);
+            dn.Year = hint.Year;
+            while ( dn.Year < today.Year &&
+                    (!validDate(dn) || makeTime(dn) / SECS_PER_DAY < m_hintDays) ) ++dn.Year;
             *powerDown = makeTime(dn);
+
+            // the power up was on or before today, and after the power down
+            up.Year = today.Year;
+            while ( up.Year > dn.Year &&
+                    (!validDate(up) || makeTime(up) / SECS_PER_DAY > todayDays) ) --up.Year;
+            *powerUp = makeTime(up);
         }
+        else {
+            dn.Year = today.Year;                       // assume current year
+            up.Year = today.Year;
+            *powerDown = makeTime(dn);
+            *powerUp = makeTime(up);
+
+            // adjust the powerDown timestamp if needed (see notes above)
+            if (*powerDown > *powerUp) {
+                --dn.Year;
+                *powerDown = makeTime(dn);
+            }
+        }
+        updateEpochHint(todayDays);
         return true;
     }
     else
         return false;
 }
 
+// Enable the epoch hint, which is used by powerFail() to determine
+// the year of the power down and power up timestamps. The hint is
+// three bytes, stored at SRAM address addr (0-61). It is the date
+// (days since 1970) on which the MCU was last known to be running,
+// followed by a CRC-8, and is updated when the time is set, and at
+// most once a day when the time is read (e.g. by the Time library's
+// periodic sync). Should be called early in setup(), before
+// powerFail(). Until a valid hint has been written (e.g. on first
+// use, or after the backup battery failed), powerFail() works as if
+// the hint were not enabled.
+// If the hint cannot be read, it is left disabled and the error is
+// returned.
+rtcStatus_t MCP79412RTC::enableEpochHint(byte addr)
+{
+    MCP79412_PROBE(RTC_OP_EPOCH_HINT);
+    byte buf[HINT_SIZE];
+
+    if (addr > SRAM_SIZE - HINT_SIZE) return m_status = RTC_BAD_ARG;
+    if (ramRead(SRAM_START_ADDR + addr, buf, HINT_SIZE) != RTC_OK) return m_status;
+    m_hintAddr = addr;
+    if (buf[2] == crc8(buf, 2))
+        m_hintDays = buf[0] | buf[1] << 8;
+    else
+        m_hintDays = HINT_INVALID;
+    return m_status;
+}
+
+// Write the epoch hint to SRAM if enabled and it has changed. A
+// failed write is tried again at the next update, and does not change
+// the status of the operation that made the update.
+void MCP79412RTC::updateEpochHint(uint16_t days)
+{
+    byte buf[HINT_SIZE];
+    rtcStatus_t status = m_status;
+
+    if (m_hintAddr < SRAM_SIZE && days != m_hintDays) {
+        buf[0] = days;
+        buf[1] = days >> 8;
+        buf[2] = crc8(buf, 2);
+        if (ramWrite(SRAM_START_ADDR + m_hintAddr, buf, HINT_SIZE) == RTC_OK) m_hintDays = days;
+        m_status = status;
+    }
+}
+
+// Decode a 4-byte power down or power up timestamp. There is no
+// seconds or year field, so those are left to the caller.
+void MCP79412RTC::readTimestamp(byte *ts, tmElements_t &tm)
+{
+    tm.Second = 0;
+    tm.Minute = bcd2dec(ts[0]);
+    tm.Hour = bcd2dec(ts[1] & ~_BV(HR1224));    // assumes 24hr clock
+    tm.Day = bcd2dec(ts[2]);
+    tm.Month = bcd2dec(ts[3] & 0x1F);           // mask off the day, we don't need it
+}
+
+// Returns false for February 29 in a year that is not a leap year,
+// which makeTime() would otherwise quietly turn into March 1.
+bool MCP79412RTC::validDate(tmElements_t &tm)
+{
+    int y = tmYearToCalendar(tm.Year);
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+
+    return !(tm.Month == 2 && tm.Day == 29 && !leap);
+}
+
 // Enable or disable the square wave output.
-void MCP79412RTC::squareWave(uint8_t freq)
+rtcStatus_t MCP79412RTC::squareWave(uint8_t freq)
 {
+    MCP79412_PROBE(RTC_OP_SQUARE_WAVE);
     uint8_t ctrlReg;
 
-    ramRead(CTRL_REG, &ctrlReg, 1);
+    if (ramRead(CTRL_REG, &ctrlReg, 1) != RTC_OK) return m_status;
     if (freq > 3) {
         ctrlReg &= ~_BV(SQWE);
     }
     else {
         ctrlReg = (ctrlReg & 0xF8) | _BV(SQWE) | freq;
     }
-    ramWrite(CTRL_REG, &ctrlReg, 1);
+    return ramWrite(CTRL_REG, &ctrlReg, 1);
 }
 
 // Set an alarm time. Sets the alarm registers only, does not enable
 // the alarm. See enableAlarm().
-void MCP79412RTC::setAlarm(uint8_t alarmNumber, time_t alarmTime)
+rtcStatus_t MCP79412RTC::setAlarm(uint8_t alarmNumber, time_t alarmTime)
 {
+    MCP79412_PROBE(RTC_OP_SET_ALARM);
     tmElements_t tm;
-    uint8_t day;        // need to preserve bits in the day (of week) register
+    uint8_t regs[6];    // need to preserve bits in the day (of week) register
 
     alarmNumber &= 0x01;        // ensure a valid alarm number
-    ramRead( ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG) , &day, 1);
+    if (ramRead( ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG) , &regs[3], 1) != RTC_OK) return m_status;
     breakTime(alarmTime, tm);
-    i2cBeginTransmission(RTC_ADDR);
-    i2cWrite( ALM0_REG + alarmNumber * (ALM1_REG - ALM0_REG) );
-    i2cWrite(dec2bcd(tm.Second));
-    i2cWrite(dec2bcd(tm.Minute));
-    i2cWrite(dec2bcd(tm.Hour));                  // sets 24 hour format (Bit 6 == 0)
-    i2cWrite( (day & 0xF8) + tm.Wday );
-    i2cWrite(dec2bcd(tm.Day));
-    i2cWrite(dec2bcd(tm.Month));
-    i2cEndTransmission();
+    regs[0] = dec2bcd(tm.Second);
+    regs[1] = dec2bcd(tm.Minute);
+    regs[2] = dec2bcd(tm.Hour);                 // sets 24 hour format (Bit 6 == 0)
+    regs[3] = (regs[3] & 0xF8) + tm.Wday;
+    regs[4] = dec2bcd(tm.Day);
+    regs[5] = dec2bcd(tm.Month);
+    return ramWrite( ALM0_REG + alarmNumber * (ALM1_REG - ALM0_REG), regs, sizeof(regs) );
 }
 
 // Enable or disable an alarm, and set the trigger criteria,
 // e.g. match only seconds, only minutes, entire time and date, etc.
-void MCP79412RTC::enableAlarm(uint8_t alarmNumber, uint8_t alarmType)
+// The alarm is not enabled unless its configuration was written.
+rtcStatus_t MCP79412RTC::enableAlarm(uint8_t alarmNumber, uint8_t alarmType)
 {
+    MCP79412_PROBE(RTC_OP_ENABLE_ALARM);
     uint8_t day;                // alarm day register has config & flag bits
     uint8_t ctrl;               // control register has alarm enable bits
 
     alarmNumber &= 0x01;        // ensure a valid alarm number
-    ramRead(CTRL_REG, &ctrl, 1);
+    if (ramRead(CTRL_REG, &ctrl, 1) != RTC_OK) return m_status;
     if (alarmType < ALM_DISABLE) {
-        ramRead(ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG), &day, 1);
+        if (ramRead(ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG), &day, 1) != RTC_OK) return m_status;
         day = ( day & 0x87 ) | alarmType << 4;  // reset interrupt flag, OR in the config bits
-        ramWrite(ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG), &day, 1);
+        if (ramWrite(ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG), &day, 1) != RTC_OK) return m_status;
         ctrl |= _BV(ALM0 + alarmNumber);        // enable the alarm
     }
     else {
         ctrl &= ~(_BV(ALM0 + alarmNumber));     // disable the alarm
     }
-    ramWrite(CTRL_REG, &ctrl, 1);
+    return ramWrite(CTRL_REG, &ctrl, 1);
 }
 
 // Returns true or false depending on whether the given alarm has been
 // triggered, and resets the alarm "interrupt" flag. This is not a real
 // interrupt, just a bit that's set when an alarm is triggered.
+// Returns false if the flag cannot be read; see lastStatus(). If it
+// is read but cannot be reset, true is returned, and the same alarm
+// is returned again by the next call.
 bool MCP79412RTC::alarm(uint8_t alarmNumber)
 {
+    MCP79412_PROBE(RTC_OP_ALARM);
     uint8_t day;                // alarm day register has config & flag bits
 
     alarmNumber &= 0x01;        // ensure a valid alarm number
-    ramRead( ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG), &day, 1);
+    if (ramRead( ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG), &day, 1) != RTC_OK) return false;
     if (day & _BV(ALMIF)) {
         day &= ~_BV(ALMIF);     // turn off the alarm "interrupt" flag
         ramWrite( ALM0_DAY + alarmNumber * (ALM1_REG - ALM0_REG), &day, 1);
@@ -535,18 +854,43 @@ bool MCP79412RTC::alarm(uint8_t alarmNumber)
         return false;
 }
 
+// Read an alarm's settings: its time into tm, except Year, as the
+// alarm registers have no year, and its type into alarmType, or
+// ALM_DISABLE if the alarm is not enabled. Returns false if the RTC
+// could not be read; see lastStatus().
+bool MCP79412RTC::readAlarm(uint8_t alarmNumber, tmElements_t &tm, uint8_t *alarmType)
+{
+    MCP79412_PROBE(RTC_OP_ALARM);
+    uint8_t regs[6];
+    uint8_t ctrl;
+
+    alarmNumber &= 0x01;        // ensure a valid alarm number
+    if (ramRead(CTRL_REG, &ctrl, 1) != RTC_OK) return false;
+    if (ramRead(ALM0_REG + alarmNumber * (ALM1_REG - ALM0_REG), regs, sizeof(regs)) != RTC_OK) return false;
+    tm.Second = bcd2dec(regs[0] & 0x7F);
+    tm.Minute = bcd2dec(regs[1] & 0x7F);
+    tm.Hour = bcd2dec(regs[2] & 0x3F);          // assumes 24hr clock
+    tm.Wday = regs[3] & 0x07;
+    tm.Day = bcd2dec(regs[4] & 0x3F);
+    tm.Month = bcd2dec(regs[5] & 0x1F);
+    tm.Year = 0;
+    *alarmType = (ctrl & _BV(ALM0 + alarmNumber)) ? (regs[3] >> 4) & 0x07 : ALM_DISABLE;
+    return true;
+}
+
 // Sets the logic level on the MFP when it's not being used as a
 // square wave or alarm output. The default is HIGH.
-void MCP79412RTC::out(bool level)
+rtcStatus_t MCP79412RTC::out(bool level)
 {
+    MCP79412_PROBE(RTC_OP_OUT);
     uint8_t ctrlReg;
 
-    ramRead(CTRL_REG, &ctrlReg, 1);
+    if (ramRead(CTRL_REG, &ctrlReg, 1) != RTC_OK) return m_status;
     if (level)
         ctrlReg |= _BV(OUT);
     else
         ctrlReg &= ~_BV(OUT);
-    ramWrite(CTRL_REG, &ctrlReg, 1);
+    return ramWrite(CTRL_REG, &ctrlReg, 1);
 }
 
 // Specifies the logic level on the Multi-Function Pin (MFP) when an
@@ -559,46 +903,154 @@ void MCP79412RTC::out(bool level)
 // Note that the state of the MFP is independent of the alarm
 // "interrupt" flags, and the alarm() function will indicate when an
 // alarm is triggered regardless of the polarity.
-void MCP79412RTC::alarmPolarity(bool polarity)
+rtcStatus_t MCP79412RTC::alarmPolarity(bool polarity)
 {
+    MCP79412_PROBE(RTC_OP_ALARM_POLARITY);
     uint8_t alm0Day;
 
-    ramRead(ALM0_DAY, &alm0Day, 1);
+    if (ramRead(ALM0_DAY, &alm0Day, 1) != RTC_OK) return m_status;
     if (polarity)
         alm0Day |= _BV(OUT);
     else
         alm0Day &= ~_BV(OUT);
-    ramWrite(ALM0_DAY, &alm0Day, 1);
+    return ramWrite(ALM0_DAY, &alm0Day, 1);
 }
 
 // Check to see if the RTC's oscillator is started (ST bit in seconds
-// register). Returns true if started.
+// register). Returns true if started, false if stopped or if the
+// register cannot be read; see lastStatus().
 bool MCP79412RTC::isRunning()
 {
-    i2cBeginTransmission(RTC_ADDR);
-    i2cWrite((uint8_t)TIME_REG);
-    i2cEndTransmission();
-
-    // request just the seconds register
-    i2cRequestFrom(RTC_ADDR, 1);
-    return i2cRead() & _BV(ST);
+    MCP79412_PROBE(RTC_OP_IS_RUNNING);
+    // read just the seconds register
+    return ramRead(TIME_REG) & _BV(ST);
 }
 
 // Set or clear the VBATEN bit. Setting the bit powers the clock and
 // SRAM from the backup battery when Vcc falls. Note that setting the
 // time via set() or write() sets the VBATEN bit.
-void MCP79412RTC::vbaten(bool enable)
+rtcStatus_t MCP79412RTC::vbaten(bool enable)
 {
+    MCP79412_PROBE(RTC_OP_VBATEN);
     uint8_t day;
 
-    ramRead(DAY_REG, &day, 1);
+    if (ramRead(DAY_REG, &day, 1) != RTC_OK) return m_status;
     if (enable)
         day |= _BV(VBATEN);
     else
         day &= ~_BV(VBATEN);
 
-    ramWrite(DAY_REG, &day, 1);
-    return;
+    return ramWrite(DAY_REG, &day, 1);
+}
+
+// Register a state block to be saved to SRAM by lastGaspSave() when
+// Vcc is failing. The block is stored at SRAM address addr (0-63),
+// preceded by one check byte, so nBytes + 1 bytes of SRAM are used.
+// All validation and address arithmetic is done here so that
+// lastGaspSave() has nothing left to do but send the bytes.
+// Number of bytes (nBytes) must be between 1 and 30 (Wire library
+// limitation) and the frame must fit in SRAM; otherwise returns false
+// and nothing is registered.
+// The same buffer is used by lastGaspRestore(), so call this function
+// early in setup(), before lastGaspRestore().
+bool MCP79412RTC::lastGaspBegin(byte addr, byte *state, byte nBytes)
+{
+#if defined(__AVR_ATtiny44__) || defined(__AVR_ATtiny84__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
+    if (nBytes >= 1 && (addr + nBytes + 1) <= SRAM_SIZE) {
+#else
+    if (nBytes >= 1 && nBytes <= (BUFFER_LENGTH - 2) && (addr + nBytes + 1) <= SRAM_SIZE) {
+#endif
+        m_lgAddr = addr + SRAM_START_ADDR;
+        m_lgState = state;
+        m_lgSize = nBytes;
+        return true;
+    }
+    else {
+        m_lgSize = 0;
+        return false;
+    }
+}
+
+// Write the registered state block to SRAM as a single I2C burst.
+// Intended to be called as soon as a brownout or power-fail warning
+// is seen, so the time between the call and the STOP condition is
+// kept to the bare minimum: one pass over the state to compute the
+// check byte, then the address, check byte and state go out
+// back-to-back. Run the bus at 400kHz, and keep the state small; each
+// byte costs about 23us on the wire at 400kHz.
+// Do not call this from an ISR: the Wire library waits for the TWI
+// interrupt, which cannot run while another ISR is running (with AVR
+// Wire/twi the call never returns). Instead, let the warning's ISR set
+// a flag, or poll the warning, and call this from loop().
+// Since the warning may come during another RTC transaction, it is
+// only safe to use when the MCU will not return to that transaction,
+// i.e. Vcc is really going away. For the same reason the burst is
+// never retried (see setRetry()); its status is left for
+// lastStatus(), in case Vcc recovers.
+void MCP79412RTC::lastGaspSave()
+{
+    MCP79412_PROBE(RTC_OP_LAST_GASP_SAVE);
+    byte *p = m_lgState;
+    byte n = m_lgSize;
+    byte check = LAST_GASP_MAGIC;
+
+    if (n == 0) return;
+    for (byte i=0; i<n; i++) check ^= p[i];
+    bus()->beginTransmission(RTC_ADDR);
+    io()->write(m_lgAddr);
+    io()->write(check);
+    for (byte i=0; i<n; i++) io()->write(p[i]);
+    m_status = busStatus(io()->endTransmission());
+}
+
+// Retrieve a state block saved by lastGaspSave(). To be called once
+// at boot, after lastGaspBegin(). If a valid frame is found in SRAM,
+// it is copied into the registered state buffer, the frame is
+// invalidated so it will not be restored twice, and true is returned.
+// Otherwise the state buffer is not changed and false is returned.
+// Either way, the power down and power up timestamps are returned as
+// from powerFail(), or as zero if no power failure was recorded.
+// Note that this consumes the power failure, so call this instead
+// of (not in addition to) powerFail(). If the frame cannot be read,
+// false is returned and it is left for the next call.
+bool MCP79412RTC::lastGaspRestore(time_t *powerDown, time_t *powerUp)
+{
+    MCP79412_PROBE(RTC_OP_LAST_GASP_RESTORE);
+    byte frame[SRAM_SIZE];
+    byte check = LAST_GASP_MAGIC;
+    bool valid = false;
+
+    if (!powerFail(powerDown, powerUp)) {
+        *powerDown = 0;
+        *powerUp = 0;
+    }
+    if (m_lgSize == 0) return false;
+
+    if (ramRead(m_lgAddr, frame, m_lgSize + 1) != RTC_OK) return false;
+    for (byte i=0; i<m_lgSize; i++) check ^= frame[i + 1];
+    if (check == frame[0]) {
+        for (byte i=0; i<m_lgSize; i++) m_lgState[i] = frame[i + 1];
+        ramWrite(m_lgAddr, (byte)~check);     // invalidate the frame
+        valid = true;
+    }
+    return valid;
+}
+
+// Calculate a CRC-8 (polynomial 0x31, initial value 0xFF) over
+// nBytes of data. Used to validate records kept in SRAM or EEPROM.
+// The initial value ensures that neither all-zero nor erased (0xFF)
+// memory passes as a valid record.
+uint8_t MCP79412RTC::crc8(const byte *data, byte nBytes)
+{
+    uint8_t crc = 0xFF;
+
+    for (byte i=0; i<nBytes; i++) {
+        crc ^= data[i];
+        for (byte b=0; b<8; b++) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+    }
+    return crc;
 }
 
 // Decimal-to-BCD conversion
@@ -613,4 +1065,6 @@ uint8_t __attribute__ ((noinline)) MCP79412RTC::bcd2dec(uint8_t n)
     return n - 6 * (n >> 4);
 }
 
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
 MCP79412RTC RTC;
+#endif
@@ -8,20 +8,34 @@
 // https://playground.arduino.cc/Code/Time
 // https://github.com/PaulStoffregen/Time
 //
-// For AVR architecture, an MCP79412RTC object named RTC is instantiated
-// by the library and I2C initialization occurs in the constructor;
-// this is for backwards compatibility.
-// For other architectures, the user needs to instantiate a MCP79412RTC
-// object and optionally initialize the I2C bus by calling
-// MCP79412RTC::begin(). The constructor has an optional bool parameter
-// to indicate whether I2C initialization should occur in the
-// constructor; this parameter defaults to true if not given.
+// An MCP79412RTC object named RTC is instantiated by the library. Its
+// constructor is constexpr, so RTC is initialized at compile time and
+// nothing runs before setup(); the I2C bus is initialized by begin(),
+// or otherwise on the first transaction with the RTC. Other
+// MCP79412RTC objects behave the same, unless constructed with
+// initI2C true, which initializes the bus in the constructor, as
+// the RTC object used to.
+//
+// Each MCP79412RTC object talks to its RTC through an MCP79412Bus
+// (see MCP79412Bus.h); by default this is the platform's I2C bus.
+// To use several RTCs, e.g. on separate buses or behind an I2C
+// multiplexer, instantiate an MCP79412RTC object for each, passing
+// its bus to the constructor. The static get() and set() functions,
+// as used with setSyncProvider(), operate on the default RTC, which
+// is the RTC object unless changed with setDefault().
+//
+// Functions that write to the RTC return an rtcStatus_t, RTC_OK if
+// the RTC acknowledged every byte. Functions that return a value, or
+// a bool, leave their status for lastStatus(). A failed transaction
+// can be retried automatically; see setRetry().
 
 #ifndef MCP79412RTC_H_INCLUDED
 #define MCP79412RTC_H_INCLUDED
 
 #include <TimeLib.h>    // https://github.com/PaulStoffregen/Time
 #include <stdint.h>
+#include <MCP79412Bus.h>
+#include <MCP79412Instrument.h>
 
 typedef uint8_t byte;
 
@@ -51,48 +65,142 @@ enum {
 #define ALARM_0 0
 #define ALARM_1 1
 
+// EEPROM polling modes for use with setEepromPolling()
+enum {
+    EEPROM_POLL_FAST,
+    EEPROM_POLL_ADAPTIVE
+};
+
+// Status of an RTC operation, as returned by the functions that write
+// to the RTC and by lastStatus()
+enum rtcStatus_t {
+    RTC_OK,
+    RTC_ADDR_NACK,      // the RTC did not acknowledge its address (not present, or busy)
+    RTC_DATA_NACK,      // the RTC did not acknowledge a data byte
+    RTC_BUS_ERROR,      // other bus error, e.g. arbitration lost
+    RTC_SHORT_READ,     // fewer bytes were read than requested
+    RTC_BAD_ARG,        // invalid argument, nothing was done
+    RTC_TIMEOUT         // the EEPROM did not complete a write in time
+};
+
+// Memory types for use with the logging classes
+enum {
+    MEM_SRAM,
+    MEM_EEPROM
+};
+
+#ifdef MCP79412RTC_INSTRUMENT
+#define MCP79412RTC_BUS_INIT(bus) m_probeBus(bus)
+#else
+#define MCP79412RTC_BUS_INIT(bus) m_bus(bus)
+#endif
+
 class MCP79412RTC
 {
     public:
-        MCP79412RTC(bool initI2C = true);
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
+        constexpr MCP79412RTC()
+            : MCP79412RTC_BUS_INIT(&rtcI2C), m_begun(false), m_lgAddr(0), m_lgState(0), m_lgSize(0),
+              m_hintAddr(0xFF), m_hintDays(0), m_status(RTC_OK), m_retries(0), m_backoffUs(0),
+              m_eepromTimeoutMs(10), m_waitCount(0), m_pollMode(EEPROM_POLL_FAST), m_writeUs(5000) {}
+        explicit MCP79412RTC(bool initI2C);
+#endif
+        constexpr MCP79412RTC(MCP79412Bus &bus)
+            : MCP79412RTC_BUS_INIT(&bus), m_begun(false), m_lgAddr(0), m_lgState(0), m_lgSize(0),
+              m_hintAddr(0xFF), m_hintDays(0), m_status(RTC_OK), m_retries(0), m_backoffUs(0),
+              m_eepromTimeoutMs(10), m_waitCount(0), m_pollMode(EEPROM_POLL_FAST), m_writeUs(5000) {}
+        MCP79412RTC(MCP79412Bus &bus, bool initI2C);
         void begin();
         static time_t get();
         static void set(time_t t);
-        static bool read(tmElements_t &tm);
-        static void write(tmElements_t &tm);
-        void sramWrite(byte addr, byte value);
-        void sramWrite(byte addr, byte *values, byte nBytes);
+        void setDefault();
+        time_t getTime();
+        bool waitSecond(time_t *t, uint32_t (*clock)(void *ctx) = 0, void *ctx = 0,
+            uint32_t *before = 0, uint32_t *after = 0);
+        rtcStatus_t setTime(time_t t);
+        bool read(tmElements_t &tm);
+        rtcStatus_t write(tmElements_t &tm);
+        rtcStatus_t sramWrite(byte addr, byte value);
+        rtcStatus_t sramWrite(byte addr, byte *values, byte nBytes);
         byte sramRead(byte addr);
-        void sramRead(byte addr, byte *values, byte nBytes);
-        void eepromWrite(byte addr, byte value);
-        void eepromWrite(byte addr, byte *values, byte nBytes);
+        rtcStatus_t sramRead(byte addr, byte *values, byte nBytes);
+        rtcStatus_t eepromWrite(byte addr, byte value);
+        rtcStatus_t eepromWrite(byte addr, byte *values, byte nBytes);
         byte eepromRead(byte addr);
-        void eepromRead(byte addr, byte *values, byte nBytes);
+        rtcStatus_t eepromRead(byte addr, byte *values, byte nBytes);
         int calibRead();
-        void calibWrite(int value);
-        void idRead(byte *uniqueID);
-        void getEUI64(byte *uniqueID);
+        rtcStatus_t calibWrite(int value);
+        rtcStatus_t idRead(byte *uniqueID);
+        rtcStatus_t getEUI64(byte *uniqueID);
         bool powerFail(time_t *powerDown, time_t *powerUp);
-        void squareWave(uint8_t freq);
-        void setAlarm(uint8_t alarmNumber, time_t alarmTime);
-        void enableAlarm(uint8_t alarmNumber, uint8_t alarmType);
+        rtcStatus_t squareWave(uint8_t freq);
+        rtcStatus_t setAlarm(uint8_t alarmNumber, time_t alarmTime);
+        rtcStatus_t enableAlarm(uint8_t alarmNumber, uint8_t alarmType);
         bool alarm(uint8_t alarmNumber);
-        void out(bool level);
-        void alarmPolarity(bool polarity);
+        bool readAlarm(uint8_t alarmNumber, tmElements_t &tm, uint8_t *alarmType);
+        rtcStatus_t out(bool level);
+        rtcStatus_t alarmPolarity(bool polarity);
         bool isRunning();
-        void vbaten(bool enable);
+        rtcStatus_t vbaten(bool enable);
+        bool lastGaspBegin(byte addr, byte *state, byte nBytes);
+        void lastGaspSave();
+        bool lastGaspRestore(time_t *powerDown, time_t *powerUp);
+        static uint8_t crc8(const byte *data, byte nBytes);
+        rtcStatus_t enableEpochHint(byte addr);
+        rtcStatus_t lastStatus();
+        void setRetry(byte retries, uint16_t backoffUs);
+        void setEepromTimeout(uint16_t timeoutMs);
+        uint16_t eepromWaitCount();
+        void setEepromPolling(uint8_t mode);
 
     private:
-        static void ramWrite(byte addr, byte value);
-        static void ramWrite(byte addr, byte *values, byte nBytes);
-        static byte ramRead(byte addr);
-        static void ramRead(byte addr, byte *values, byte nBytes);
-        static byte eepromWait();
+#ifdef MCP79412RTC_INSTRUMENT
+        MCP79412ProbeBus m_probeBus;    // counts the traffic on the bus the RTC is on
+#else
+        MCP79412Bus *m_bus;     // the bus the RTC is on
+#endif
+        bool m_begun;           // whether the bus has been initialized
+        byte m_lgAddr;          // RTC RAM address of the last-gasp frame (check byte)
+        byte *m_lgState;        // caller's state block, written by lastGaspSave()
+        byte m_lgSize;          // number of bytes in the state block, zero if not registered
+        byte m_hintAddr;        // SRAM address of the epoch hint, 0xFF if disabled
+        uint16_t m_hintDays;    // copy of the epoch hint (days since 1970), 0xFFFF if not valid
+        rtcStatus_t m_status;   // status of the last operation
+        byte m_retries;         // times to retry a failed transaction
+        uint16_t m_backoffUs;   // wait before the first retry, doubled for each further retry
+        uint16_t m_eepromTimeoutMs; // longest wait for an EEPROM write
+        uint16_t m_waitCount;   // EEPROM polls for the last write
+        byte m_pollMode;        // EEPROM_POLL_FAST or EEPROM_POLL_ADAPTIVE
+        uint16_t m_writeUs;     // expected EEPROM write time, for adaptive polling
+        static MCP79412RTC *m_default;  // RTC used by get() and set()
+
+        // the bus, through this object's own probe if instrumented, so
+        // that a copy of the object does not use the original's
+#ifdef MCP79412RTC_INSTRUMENT
+        MCP79412Bus *io() { return &m_probeBus; }
+#else
+        MCP79412Bus *io() { return m_bus; }
+#endif
+        MCP79412Bus *bus() { if (!m_begun) begin(); return io(); }
+        rtcStatus_t writeRegs(byte devAddr, byte reg, const byte *values, byte nBytes);
+        rtcStatus_t readRegs(byte devAddr, byte reg, byte *values, byte nBytes);
+        bool retryWait(byte attempt);
+        static rtcStatus_t busStatus(uint8_t txStatus);
+        rtcStatus_t ramWrite(byte addr, byte value);
+        rtcStatus_t ramWrite(byte addr, byte *values, byte nBytes);
+        byte ramRead(byte addr);
+        rtcStatus_t ramRead(byte addr, byte *values, byte nBytes);
+        rtcStatus_t eepromWait();
+        void updateEpochHint(uint16_t days);
+        static void readTimestamp(byte *ts, tmElements_t &tm);
+        static bool validDate(tmElements_t &tm);
         static uint8_t dec2bcd(uint8_t num);
         static uint8_t bcd2dec(uint8_t num);
 };
 
+#ifndef MCP79412RTC_NO_DEFAULT_BUS
 extern MCP79412RTC RTC;
+#endif
 
 #ifndef _BV
 #define _BV(bit) (1 << (bit))
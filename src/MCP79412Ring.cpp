@@ -0,0 +1,228 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Ring buffer of fixed-size records in the MCP7941x's SRAM or EEPROM.
+// See MCP79412Ring.h for details.
+
+#include <MCP79412Ring.h>
+
+#define RING_SRAM_SIZE 64       // number of bytes of RTC SRAM
+#define RING_EEPROM_SIZE 128    // number of bytes of RTC EEPROM
+
+// Decode a record. Returns false if the record is not valid
+// (CRC error, or never written).
+static bool decode(const byte *rec, uint32_t *key, uint32_t *value)
+{
+    if (rec[RING_RECORD_SIZE - 1] != MCP79412RTC::crc8(rec, RING_RECORD_SIZE - 1))
+        return false;
+    *key = rec[0] | (uint32_t)rec[1] << 8 | (uint32_t)rec[2] << 16 | (uint32_t)rec[3] << 24;
+    *value = rec[4] | (uint32_t)rec[5] << 8 | (uint32_t)rec[6] << 16;
+    return *key != 0;
+}
+
+MCP79412Ring::MCP79412Ring(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_memType(MEM_SRAM), m_addr(0), m_nRecords(0), m_next(0), m_valid(0)
+{
+}
+
+// Define the memory used for the ring: nRecords records of 8 bytes
+// each, starting at address addr in SRAM (memType == MEM_SRAM, 0-63)
+// or EEPROM (memType == MEM_EEPROM, 0-127). EEPROM addresses are
+// coerced to a page boundary. Scans the ring to find the newest
+// record, so must be called before the other functions.
+// Returns false if the ring does not fit in the memory, or it could
+// not be read; the ring is then empty, and nothing is written to it.
+bool MCP79412Ring::begin(byte memType, byte addr, byte nRecords)
+{
+    byte buf[BUFFER_LENGTH];
+    uint32_t key, value, newestKey = 0;
+    byte memSize = (memType == MEM_EEPROM) ? RING_EEPROM_SIZE : RING_SRAM_SIZE;
+
+    if (memType == MEM_EEPROM) addr &= ~(RING_RECORD_SIZE - 1);
+    if (nRecords < 1 || addr + nRecords * RING_RECORD_SIZE > memSize) {
+        m_nRecords = 0;
+        return false;
+    }
+    m_memType = memType;
+    m_addr = addr;
+    m_nRecords = nRecords;
+    m_next = 0;
+    m_valid = 0;
+
+    for (byte slot=0; slot<m_nRecords; ) {
+        byte nRec = readSlots(slot, buf);
+        if (nRec == 0) {
+            m_nRecords = 0;
+            m_valid = 0;
+            return false;
+        }
+        for (byte i=0; i<nRec; i++, slot++) {
+            if (decode(&buf[i * RING_RECORD_SIZE], &key, &value)) {
+                m_valid |= (uint16_t)1 << slot;
+                if (key >= newestKey) {
+                    newestKey = key;
+                    m_next = (slot + 1) % m_nRecords;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Add a record, overwriting the oldest one if the ring is full.
+// The key should be larger than that of any record already in the
+// ring. Only the lower 24 bits of the value are stored. Returns false
+// if the record could not be written; the next append() then goes
+// to the same slot.
+bool MCP79412Ring::append(uint32_t key, uint32_t value)
+{
+    byte rec[RING_RECORD_SIZE];
+
+    if (m_nRecords == 0) return false;
+    rec[0] = key;
+    rec[1] = key >> 8;
+    rec[2] = key >> 16;
+    rec[3] = key >> 24;
+    rec[4] = value;
+    rec[5] = value >> 8;
+    rec[6] = value >> 16;
+    rec[7] = MCP79412RTC::crc8(rec, RING_RECORD_SIZE - 1);
+    if (writeRecord(m_next, rec) != RTC_OK) {
+        // the slot may now hold part of the record
+        m_valid &= ~((uint16_t)1 << m_next);
+        return false;
+    }
+
+    m_valid |= (uint16_t)1 << m_next;
+    m_next = (m_next + 1) % m_nRecords;
+    return true;
+}
+
+// Read the records in the ring into the caller's arrays, oldest first.
+// If there are more than maxRecords records, only the newest ones are
+// returned. The oldest record is at m_next, so the ring is read as at
+// most two contiguous runs of memory, in as few I2C transactions as
+// the buffer size allows. Records that fail the CRC check are
+// skipped. Returns the number of records returned, or zero if the
+// ring could not be read.
+byte MCP79412Ring::read(uint32_t *keys, uint32_t *values, byte maxRecords)
+{
+    byte buf[BUFFER_LENGTH];
+    byte nValid = count();
+    byte skip = (nValid > maxRecords) ? nValid - maxRecords : 0;
+    byte slot = m_next;
+    byte remaining = m_nRecords;
+    byte n = 0;
+
+    while (remaining > 0) {
+        byte nRec = readSlots(slot, buf);
+        if (nRec == 0) return 0;
+        if (nRec > remaining) nRec = remaining;
+        for (byte i=0; i<nRec; i++) {
+            uint32_t key, value;
+            if ( !(m_valid & ((uint16_t)1 << ((slot + i) % m_nRecords))) ) continue;
+            if (skip > 0) {
+                --skip;
+            }
+            else if (decode(&buf[i * RING_RECORD_SIZE], &key, &value)) {
+                keys[n] = key;
+                values[n] = value;
+                ++n;
+            }
+        }
+        remaining -= nRec;
+        slot = (slot + nRec) % m_nRecords;
+    }
+    return n;
+}
+
+// Return the newest record. Returns false if the ring is empty, the
+// newest record is not valid, or it could not be read; in the last
+// case MCP79412RTC::lastStatus() is not RTC_OK.
+bool MCP79412Ring::newest(uint32_t *key, uint32_t *value)
+{
+    byte buf[RING_RECORD_SIZE];
+
+    if (m_nRecords == 0) return false;
+    byte slot = (m_next + m_nRecords - 1) % m_nRecords;
+    if (!(m_valid & ((uint16_t)1 << slot))) return false;
+    if (readBytes(m_addr + slot * RING_RECORD_SIZE, buf, RING_RECORD_SIZE) != RTC_OK) return false;
+    return decode(buf, key, value);
+}
+
+// Return the oldest record. Returns false if the ring is empty, the
+// oldest record is not valid, or it could not be read.
+bool MCP79412Ring::oldest(uint32_t *key, uint32_t *value)
+{
+    byte buf[RING_RECORD_SIZE];
+
+    for (byte i=0; i<m_nRecords; i++) {
+        byte slot = (m_next + i) % m_nRecords;
+        if (m_valid & ((uint16_t)1 << slot)) {
+            if (readBytes(m_addr + slot * RING_RECORD_SIZE, buf, RING_RECORD_SIZE) != RTC_OK) return false;
+            return decode(buf, key, value);
+        }
+    }
+    return false;
+}
+
+// Returns the number of records in the ring.
+byte MCP79412Ring::count()
+{
+    byte n = 0;
+
+    for (uint16_t v = m_valid; v; v >>= 1) n += v & 1;
+    return n;
+}
+
+// Remove all records from the ring. Returns false if a slot could
+// not be cleared; the records in the slots that were cleared are
+// gone, and the others are kept.
+bool MCP79412Ring::clear()
+{
+    byte zeros[RING_RECORD_SIZE] = {0};
+    bool ok = true;
+
+    for (byte i=0; i<m_nRecords; i++) {
+        if (writeRecord(i, zeros) == RTC_OK)
+            m_valid &= ~((uint16_t)1 << i);
+        else
+            ok = false;
+    }
+    if (ok) m_next = 0;
+    return ok;
+}
+
+// Read as many records as fit in the I2C buffer, starting at the
+// given slot and stopping at the end of the ring. Returns the number
+// of records read into buf, or zero if they could not be read.
+byte MCP79412Ring::readSlots(byte slot, byte *buf)
+{
+    byte nRec = m_nRecords - slot;
+
+    if (nRec > BUFFER_LENGTH / RING_RECORD_SIZE) nRec = BUFFER_LENGTH / RING_RECORD_SIZE;
+    if (readBytes(m_addr + slot * RING_RECORD_SIZE, buf, nRec * RING_RECORD_SIZE) != RTC_OK) return 0;
+    return nRec;
+}
+
+// Read bytes from the ring's memory.
+rtcStatus_t MCP79412Ring::readBytes(byte addr, byte *values, byte nBytes)
+{
+    if (m_memType == MEM_EEPROM)
+        return m_rtc.eepromRead(addr, values, nBytes);
+    else
+        return m_rtc.sramRead(addr, values, nBytes);
+}
+
+// Write one record. In EEPROM, this is a single page write.
+rtcStatus_t MCP79412Ring::writeRecord(byte slot, byte *rec)
+{
+    byte addr = m_addr + slot * RING_RECORD_SIZE;
+
+    if (m_memType == MEM_EEPROM)
+        return m_rtc.eepromWrite(addr, rec, RING_RECORD_SIZE);
+    else
+        return m_rtc.sramWrite(addr, rec, RING_RECORD_SIZE);
+}
@@ -0,0 +1,52 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Ring buffer of fixed-size records in the MCP7941x's SRAM or EEPROM,
+// used by the logging classes.
+//
+// Each record is 8 bytes, exactly one EEPROM page: a 32-bit key that
+// increases from one record to the next (normally a time_t), a 24-bit
+// value, and a CRC-8 over the first 7 bytes. The newest record is
+// found by its key, so there is no header to rewrite on every append,
+// and in EEPROM the writes rotate over all the pages of the ring.
+//
+// A bus error (see MCP79412RTC::lastStatus()) is not taken for a
+// missing or corrupt record: a failed read is reported to the caller,
+// and a record that could not be written is not taken to be there.
+
+#ifndef MCP79412RING_H_INCLUDED
+#define MCP79412RING_H_INCLUDED
+
+#include <MCP79412RTC.h>
+
+#define RING_RECORD_SIZE 8      // bytes per record
+
+class MCP79412Ring
+{
+    public:
+        MCP79412Ring(MCP79412RTC &rtc);
+        bool begin(byte memType, byte addr, byte nRecords);
+        bool append(uint32_t key, uint32_t value);
+        byte read(uint32_t *keys, uint32_t *values, byte maxRecords);
+        bool newest(uint32_t *key, uint32_t *value);
+        bool oldest(uint32_t *key, uint32_t *value);
+        byte count();
+        byte capacity() { return m_nRecords; }
+        bool clear();
+
+    private:
+        rtcStatus_t readBytes(byte addr, byte *values, byte nBytes);
+        byte readSlots(byte slot, byte *buf);
+        rtcStatus_t writeRecord(byte slot, byte *rec);
+
+        MCP79412RTC &m_rtc;
+        byte m_memType;             // MEM_SRAM or MEM_EEPROM
+        byte m_addr;                // first address of the ring
+        byte m_nRecords;            // number of slots in the ring
+        byte m_next;                // slot to be written by the next append()
+        uint16_t m_valid;           // bit n set if slot n holds a valid record
+};
+
+#endif
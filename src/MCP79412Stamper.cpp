@@ -0,0 +1,186 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Timestamps events to 1/32768 second from the RTC's 32.768kHz square
+// wave. See MCP79412Stamper.h for details.
+
+#include <MCP79412Stamper.h>
+
+#define STAMP_MASK (MCP79412RTC_STAMPS - 1)
+#define MAX_SPAN 0x40000000UL       // counts from the anchor before it is moved up, about 9 hours
+
+MCP79412Stamper::MCP79412Stamper(MCP79412RTC &rtc, uint16_t (*readCounter)(), bool (*overflowPending)())
+    : m_rtc(rtc), m_readCounter(readCounter), m_overflowPending(overflowPending), m_overflows(0),
+      m_wraps(0), m_anchored(false), m_anchorTime(0), m_anchorCount(0), m_anchorWraps(0), m_halfWidth(0),
+      m_head(0), m_tail(0), m_dropped(0)
+{
+}
+
+// Turn on the RTC's 32.768kHz square wave, and anchor the count to the
+// RTC's time. The counter and its overflow interrupt must be set up
+// first. Returns false if the RTC could not be read, or the counter
+// is not running.
+bool MCP79412Stamper::begin(byte edges)
+{
+    if (m_rtc.squareWave(SQWAVE_32768_HZ) != RTC_OK) return false;
+    return anchor(edges);
+}
+
+// Find the count at an RTC seconds edge, to within the overlap of
+// the given number of edges, which takes that many seconds. Returns
+// false if the RTC could not be read, or the counter is not running;
+// the previous anchor, if any, is then kept.
+bool MCP79412Stamper::anchor(byte edges)
+{
+    time_t t, t0 = 0;
+    uint32_t lo, hi, lo0 = 0, hi0 = 0;
+
+    for (byte i=0; i<edges; i++) {
+        // lo is before the last read of the old time, hi after the
+        // first read of the new; the counter must be running
+        uint32_t first = count();
+        if (!m_rtc.waitSecond(&t, counter, this, &lo, &hi) || hi == first) return false;
+        if (i > 0) {
+            // this edge, moved back to the first edge, overlapped with what is known of it
+            uint32_t shift = (uint32_t)(t - t0) * STAMP_HZ;
+            int32_t l = (int32_t)(lo - shift - lo0);
+            int32_t h = (int32_t)(hi - shift - lo0);
+            if (l < 0) l = 0;
+            if (h > (int32_t)(hi0 - lo0)) h = hi0 - lo0;
+            if (l <= h) {
+                hi0 = lo0 + h;
+                lo0 += l;
+                continue;
+            }
+            // no overlap, e.g. the count slipped against the seconds
+            // after a calibration step; start again from this edge
+        }
+        t0 = t;
+        lo0 = lo;
+        hi0 = hi;
+    }
+    uint16_t wraps;
+    uint32_t now = count(&wraps);
+    m_anchorTime = t0;
+    m_anchorCount = lo0 + (hi0 - lo0) / 2;
+    m_anchorWraps = (m_anchorCount > now) ? wraps - 1 : wraps;
+    m_halfWidth = (hi0 - lo0 + 1) / 2;
+    m_anchored = true;
+    return true;
+}
+
+// Returns the count, extended to 32 bits with the overflows. Safe to
+// call from an ISR.
+uint32_t MCP79412Stamper::count()
+{
+    return count(0);
+}
+
+// Returns the count, and sets *wraps, if given, to the times it has
+// wrapped.
+uint32_t MCP79412Stamper::count(uint16_t *wraps)
+{
+    uint16_t overflows, counter, w;
+    bool pending;
+
+    do {
+        w = m_wraps;
+        overflows = m_overflows;
+        counter = m_readCounter();
+        pending = m_overflowPending && m_overflowPending();
+    } while (overflows != m_overflows || w != m_wraps);
+    // the counter wrapped, but the overflow interrupt has yet to run
+    if (pending && counter < 0x8000 && ++overflows == 0) w++;
+    if (wraps) *wraps = w;
+    return ((uint32_t)overflows << 16) | counter;
+}
+
+// Timestamp an event, e.g. from its interrupt. Saves the count for
+// read(); if the ring is full, the event is counted as dropped.
+void MCP79412Stamper::stamp()
+{
+    uint32_t c = count();
+
+    if ((byte)(m_head - m_tail) >= MCP79412RTC_STAMPS) {
+        m_dropped++;
+    }
+    else {
+        m_ring[m_head & STAMP_MASK] = c;
+        m_head++;
+    }
+}
+
+// Move the anchor up by whole seconds once the count is MAX_SPAN past
+// it, so that the counts to convert stay within reach of a 32-bit
+// difference. Call from loop() at least every 9 hours, whether or not
+// events are stamped; read(), available() and toTime() call it. If it
+// was not called in time, the anchor is out of reach: the stamper is
+// then no longer anchored, and the events waiting are discarded, until
+// anchor() succeeds again. Not for use from an ISR.
+void MCP79412Stamper::service()
+{
+    uint16_t wraps;
+
+    if (!m_anchored) return;
+    uint32_t now = count(&wraps);
+    uint16_t wrapped = wraps - m_anchorWraps;
+    uint32_t ahead = now - m_anchorCount;
+    // the count is less than a wrap past the anchor, and within reach
+    if (((wrapped == 0 && now >= m_anchorCount) || (wrapped == 1 && now < m_anchorCount))
+            && ahead < 2 * MAX_SPAN) {
+        if (ahead >= MAX_SPAN) {
+            uint32_t secs = ahead / STAMP_HZ;
+            uint32_t moved = m_anchorCount + secs * STAMP_HZ;
+            if (moved < m_anchorCount) m_anchorWraps++;
+            m_anchorTime += secs;
+            m_anchorCount = moved;
+        }
+        return;
+    }
+    m_anchored = false;
+    m_tail = m_head;
+}
+
+// Returns the number of events waiting to be read.
+byte MCP79412Stamper::available()
+{
+    service();
+    return m_head - m_tail;
+}
+
+// Get the oldest event's timestamp, and remove it from the ring. Call
+// from loop(); an event must be read within 9 hours of being stamped.
+// Returns false if there are no events, or the stamper is not anchored
+// (see service()).
+bool MCP79412Stamper::read(rtcStamp_t &stamp)
+{
+    service();
+    if (m_head == m_tail || !m_anchored) return false;
+    uint32_t c = m_ring[m_tail & STAMP_MASK];
+    m_tail++;
+    return toTime(c, stamp);
+}
+
+// Convert a count, e.g. from count(), to a timestamp. The count must
+// be within 18 hours of the anchor, which service() keeps within 9
+// hours of the present. Not for use from an ISR. Returns false if the
+// stamper is not anchored (see service()).
+bool MCP79412Stamper::toTime(uint32_t count, rtcStamp_t &stamp)
+{
+    service();
+    if (!m_anchored) return false;
+    int32_t d = (int32_t)(count - m_anchorCount);
+    int32_t secs = (d >= 0) ? d / STAMP_HZ : -((STAMP_HZ - 1 - d) / STAMP_HZ);
+    stamp.time = m_anchorTime + secs;
+    stamp.ticks = d - secs * STAMP_HZ;
+    return true;
+}
+
+// The count, for MCP79412RTC::waitSecond() to note when the RTC's
+// seconds change.
+uint32_t MCP79412Stamper::counter(void *stamper)
+{
+    return ((MCP79412Stamper*)stamper)->count();
+}
@@ -0,0 +1,88 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Timestamps events, e.g. from a GPIO interrupt, to 1/32768 second
+// (about 30us), without reading the RTC when the event happens.
+//
+// The RTC's MFP puts out its 32.768kHz square wave, which clocks a
+// hardware counter on the MCU, e.g. Timer1 on an AVR with the MFP on
+// its T1 pin. The application supplies a function that reads the
+// counter (16 bits), and calls overflow() from the counter's overflow
+// interrupt; if stamp() can be called while the overflow interrupt is
+// pending, e.g. from any ISR on an AVR, it also supplies a function
+// that returns true when it is, e.g. reading TOV1.
+//
+// anchor() pairs an RTC seconds edge with a count. The edge is found
+// by reading the RTC until the seconds change, which puts it between
+// two reads; as the counter runs from the RTC's own oscillator, the
+// edges after it are 32768 counts apart, so anchoring at several edges
+// narrows it down to the overlap. stamp() saves the count in a ring,
+// for read() to convert to a time later, from loop(). The count wraps
+// every 36 hours, so service() (or read() or available()) must be
+// called from loop() at least every 9 hours to keep the anchor close
+// to it, even when there are no events; if it is not, the stamper
+// stops converting counts until anchor() is called again.
+//
+// The 32.768kHz output is not trimmed by the calibration register
+// (see calibWrite()), so with a non-zero calibration, anchor() should
+// be called again from time to time, e.g. hourly. The MFP cannot be
+// used for alarms or the 1Hz square wave at the same time.
+
+#ifndef MCP79412STAMPER_H_INCLUDED
+#define MCP79412STAMPER_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <MCP79412Port.h>
+
+// events held until read(), a power of 2 up to 128
+#ifndef MCP79412RTC_STAMPS
+#define MCP79412RTC_STAMPS 8
+#endif
+
+#define STAMP_HZ 32768
+
+// A timestamp
+struct rtcStamp_t {
+    time_t time;            // RTC time
+    uint16_t ticks;         // and 1/32768 seconds since it began
+};
+
+class MCP79412Stamper
+{
+    public:
+        MCP79412Stamper(MCP79412RTC &rtc, uint16_t (*readCounter)(), bool (*overflowPending)() = 0);
+        bool begin(byte edges = 4);
+        bool anchor(byte edges = 4);
+        uint16_t uncertainty() { return m_halfWidth; }
+        void overflow() { if (++m_overflows == 0) m_wraps++; }
+        uint32_t count();
+        void stamp();
+        void service();
+        byte available();
+        bool read(rtcStamp_t &stamp);
+        bool toTime(uint32_t count, rtcStamp_t &stamp);
+        uint16_t dropped() { return m_dropped; }
+
+    private:
+        uint32_t count(uint16_t *wraps);
+        static uint32_t counter(void *stamper);
+
+        MCP79412RTC &m_rtc;
+        uint16_t (*m_readCounter)();
+        bool (*m_overflowPending)();
+        volatile uint16_t m_overflows;          // counter overflows, the upper 16 bits of the count
+        volatile uint16_t m_wraps;              // times the 32-bit count has wrapped, every 36 hours
+        bool m_anchored;
+        time_t m_anchorTime;                    // an RTC seconds edge
+        uint32_t m_anchorCount;                 // and the count at it
+        uint16_t m_anchorWraps;                 // m_wraps when the count was m_anchorCount
+        uint16_t m_halfWidth;                   // the edge is within this many counts of m_anchorCount
+        volatile uint32_t m_ring[MCP79412RTC_STAMPS];
+        volatile byte m_head;                   // next slot for stamp()
+        volatile byte m_tail;                   // next slot for read()
+        volatile uint16_t m_dropped;            // events lost with the ring full
+};
+
+#endif
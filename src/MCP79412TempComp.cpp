@@ -0,0 +1,115 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Temperature compensation for the MCP7941x. See MCP79412TempComp.h
+// for details.
+
+#include <MCP79412TempComp.h>
+
+#define TABLE_OVERHEAD 2        // entry count before the entries, CRC after them
+#define TABLE_ENTRIES 1         // offset of the first entry
+#define EEPROM_PAGE_SIZE 8      // number of bytes on an EEPROM page
+
+MCP79412TempComp::MCP79412TempComp(MCP79412RTC &rtc, float (*readTemp)())
+    : m_rtc(rtc), m_readTemp(readTemp), m_nEntries(0), m_interval(300),
+      m_lastUpdate(0), m_trim(0)
+{
+}
+
+// Write a compensation table to EEPROM starting at addr, which is
+// coerced to a page boundary. The entries must be in order of
+// increasing temperature. Normally done once, at provisioning; the
+// table then stays in EEPROM. Returns false if the table is empty,
+// too large, out of order, has a calibration value outside -127 to
+// 127 (see calibWrite()), does not fit in EEPROM, or could not be
+// written.
+bool MCP79412TempComp::storeTable(byte addr, const tempTrim_t *table, byte nEntries)
+{
+    byte buf[TABLE_OVERHEAD + 2 * TEMPCOMP_MAX_ENTRIES];
+    byte nBytes = TABLE_OVERHEAD + 2 * nEntries;
+
+    addr &= ~(EEPROM_PAGE_SIZE - 1);
+    if (nEntries < 1 || nEntries > TEMPCOMP_MAX_ENTRIES || addr + nBytes > 128) return false;
+    for (byte i=0; i<nEntries; i++) {
+        if (i > 0 && table[i].temp <= table[i - 1].temp) return false;
+        if (table[i].trim < -127) return false;
+        buf[TABLE_ENTRIES + 2 * i] = table[i].temp;
+        buf[TABLE_ENTRIES + 2 * i + 1] = table[i].trim;
+    }
+    buf[0] = nEntries;
+    buf[nBytes - 1] = MCP79412RTC::crc8(buf, nBytes - 1);
+
+    for (byte i=0; i<nBytes; i+=EEPROM_PAGE_SIZE) {
+        byte n = (nBytes - i < EEPROM_PAGE_SIZE) ? nBytes - i : EEPROM_PAGE_SIZE;
+        if (m_rtc.eepromWrite(addr + i, &buf[i], n) != RTC_OK) return false;
+    }
+    return true;
+}
+
+// Load the compensation table from EEPROM at addr (coerced to a page
+// boundary, as for storeTable()), and set the interval in seconds
+// between temperature samples. Returns false if there is no valid
+// table, or the RTC could not be read, in which case update() does
+// nothing.
+bool MCP79412TempComp::begin(byte addr, uint16_t interval)
+{
+    byte buf[TABLE_OVERHEAD + 2 * TEMPCOMP_MAX_ENTRIES];
+
+    addr &= ~(EEPROM_PAGE_SIZE - 1);
+    m_interval = interval;
+    m_lastUpdate = 0;
+    m_nEntries = 0;
+    m_trim = m_rtc.calibRead();
+    if (m_rtc.lastStatus() != RTC_OK) return false;
+
+    byte nBytes = sizeof(buf);
+    if (addr + nBytes > 128) nBytes = 128 - addr;
+    if (m_rtc.eepromRead(addr, buf, nBytes) != RTC_OK) return false;
+    byte n = buf[0];
+    if (n < 1 || n > TEMPCOMP_MAX_ENTRIES || TABLE_OVERHEAD + 2 * n > nBytes
+        || buf[TABLE_OVERHEAD + 2 * n - 1] != MCP79412RTC::crc8(buf, TABLE_OVERHEAD + 2 * n - 1)) return false;
+
+    for (byte i=0; i<n; i++) {
+        m_table[i].temp = buf[TABLE_ENTRIES + 2 * i];
+        m_table[i].trim = buf[TABLE_ENTRIES + 2 * i + 1];
+    }
+    m_nEntries = n;
+    return true;
+}
+
+// Call frequently from loop() with the current time. Every interval
+// seconds, samples the temperature and updates the calibration
+// register if the interpolated value differs from the last one
+// written. Returns true if the calibration register was written; if
+// the write fails, it is tried again at the next sample.
+bool MCP79412TempComp::update(time_t now)
+{
+    if (m_nEntries == 0) return false;
+    if (m_lastUpdate != 0 && now - m_lastUpdate < m_interval) return false;
+    m_lastUpdate = now;
+
+    int trim = trimFor(m_readTemp());
+    if (trim == m_trim || m_rtc.calibWrite(trim) != RTC_OK) return false;
+    m_trim = trim;
+    return true;
+}
+
+// Returns the calibration value for the given temperature, linearly
+// interpolated between table entries and rounded. Temperatures
+// outside the table use the first or last entry.
+int MCP79412TempComp::trimFor(float temp)
+{
+    if (m_nEntries == 0) return m_trim;
+    if (temp <= m_table[0].temp) return m_table[0].trim;
+    for (byte i=1; i<m_nEntries; i++) {
+        if (temp <= m_table[i].temp) {
+            float t0 = m_table[i - 1].temp;
+            float v0 = m_table[i - 1].trim;
+            float v = v0 + (m_table[i].trim - v0) * (temp - t0) / (m_table[i].temp - t0);
+            return (v < 0) ? (int)(v - 0.5) : (int)(v + 0.5);
+        }
+    }
+    return m_table[m_nEntries - 1].trim;
+}
@@ -0,0 +1,49 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Temperature compensation for the MCP7941x. A table of calibration
+// register values by temperature is kept in the RTC's EEPROM. The
+// temperature is sampled periodically from a function supplied by the
+// caller, the calibration value is interpolated from the table, and
+// the calibration register is written only when the value changes.
+//
+// The table takes 2 bytes per entry (temperature in degrees C,
+// calibration value), up to 15 entries, preceded by the count and
+// followed by a CRC over the count and the entries, so it fits in
+// 32 bytes of EEPROM and is read in one transaction.
+
+#ifndef MCP79412TEMPCOMP_H_INCLUDED
+#define MCP79412TEMPCOMP_H_INCLUDED
+
+#include <MCP79412RTC.h>
+
+#define TEMPCOMP_MAX_ENTRIES 15
+
+// A temperature compensation table entry
+struct tempTrim_t {
+    int8_t temp;            // temperature, degrees C
+    int8_t trim;            // calibration register value at that temperature
+};
+
+class MCP79412TempComp
+{
+    public:
+        MCP79412TempComp(MCP79412RTC &rtc, float (*readTemp)());
+        bool storeTable(byte addr, const tempTrim_t *table, byte nEntries);
+        bool begin(byte addr, uint16_t interval = 300);
+        bool update(time_t now);
+        int trimFor(float temp);
+
+    private:
+        MCP79412RTC &m_rtc;
+        float (*m_readTemp)();      // temperature source
+        tempTrim_t m_table[TEMPCOMP_MAX_ENTRIES];
+        byte m_nEntries;            // entries in the table, zero if no valid table
+        uint16_t m_interval;        // seconds between temperature samples
+        time_t m_lastUpdate;        // time of the last sample
+        int m_trim;                 // value last written to the calibration register
+};
+
+#endif
@@ -0,0 +1,257 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Keeps time on the MCU from the RTC's square wave. See
+// MCP79412Timebase.h for details.
+
+#include <MCP79412Timebase.h>
+#ifdef __AVR__
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#endif
+
+#define TIMER2_RATE 32              // Timer2 counts per second, 32.768kHz / 1024
+#define TIMER2_TIMEOUT 1000UL       // us to wait for Timer2's registers to update, many cycles of its clock
+
+#ifdef MCP79412RTC_TIMER2
+#if !defined(__AVR__) || !defined(EXCLK)
+#error "MCP79412RTC_TIMER2 needs an AVR with Timer2's external clock input (EXCLK)"
+#endif
+
+MCP79412Timebase *MCP79412Timebase::m_timer2;
+
+ISR(TIMER2_OVF_vect)
+{
+    MCP79412Timebase::timer2Overflow();
+}
+
+EMPTY_INTERRUPT(TIMER2_COMPA_vect);     // only wakes the MCU
+
+// Count an overflow of Timer2, every 8 seconds.
+void MCP79412Timebase::timer2Overflow()
+{
+    if (m_timer2) m_timer2->m_count += 256;
+}
+
+// Wait until Timer2's registers have been updated from the
+// asynchronous clock, which takes up to two cycles of it. Returns
+// false if they are not, e.g. the MFP is not putting out the clock.
+static bool timer2Wait()
+{
+    uint32_t start = MCP79412RTC_MICROS();
+
+    while (ASSR & (_BV(TCN2UB) | _BV(OCR2AUB) | _BV(OCR2BUB) | _BV(TCR2AUB) | _BV(TCR2BUB))) {
+        if (MCP79412RTC_MICROS() - start > TIMER2_TIMEOUT) return false;
+    }
+    return true;
+}
+#endif
+
+MCP79412Timebase::MCP79412Timebase(MCP79412RTC &rtc)
+    : m_rtc(rtc), m_rate(0), m_base(0), m_count(0), m_wake(0)
+{
+}
+
+// Turn on the RTC's square wave, SQWAVE_1_HZ or SQWAVE_32768_HZ, and
+// start counting from the RTC's time at its next seconds edge, which
+// takes up to a second. For 1Hz, tick() must be attached to the
+// interrupt first. Returns false if 32.768kHz was asked for and the
+// library was not compiled for Timer2, the RTC could not be read, or
+// Timer2 is not clocked from the MFP (e.g. it is not wired to TOSC1).
+bool MCP79412Timebase::begin(uint8_t freq)
+{
+    time_t t;
+
+    m_rate = 0;
+#ifdef MCP79412RTC_TIMER2
+    if (freq != SQWAVE_1_HZ && freq != SQWAVE_32768_HZ) return false;
+#else
+    if (freq != SQWAVE_1_HZ) return false;
+#endif
+
+    // the MFP must be putting out the clock before Timer2 is switched
+    // to it, else Timer2's registers are never updated
+    if (m_rtc.squareWave(freq) != RTC_OK) return false;
+#ifdef MCP79412RTC_TIMER2
+    if (freq == SQWAVE_32768_HZ) {
+        TIMSK2 = 0;
+        ASSR = _BV(EXCLK);                  // EXCLK must be set before AS2
+        ASSR |= _BV(AS2);
+        TCCR2A = 0;
+        TCCR2B = _BV(CS22) | _BV(CS21) | _BV(CS20);     // 32.768kHz / 1024
+        if (!timer2Wait()) return false;
+    }
+#endif
+    if (!m_rtc.waitSecond(&t)) return false;
+#ifdef MCP79412RTC_TIMER2
+    if (freq == SQWAVE_32768_HZ) {
+        GTCCR = _BV(PSRASY);                // restart the prescaler and the count at the edge
+        TCNT2 = 0;
+        m_count = 0;
+        if (!timer2Wait()) return false;
+        TIFR2 = _BV(OCF2B) | _BV(OCF2A) | _BV(TOV2);
+        m_timer2 = this;
+        TIMSK2 = _BV(TOIE2);
+        m_rate = TIMER2_RATE;
+    }
+    else
+#endif
+    {
+        m_count = 0;
+        m_rate = 1;
+    }
+    m_base = t;
+    return true;
+}
+
+// Returns the time, or zero before begin() has succeeded.
+time_t MCP79412Timebase::now()
+{
+    if (m_rate == 0) return 0;
+    return m_base + count() / m_rate;
+}
+
+// Returns the next time the given alarm will match, from its settings
+// in the RTC, as set by setAlarm() and enableAlarm(). Returns zero if
+// the alarm is not enabled, it will not match (e.g. a date that does
+// not exist), or the RTC could not be read.
+time_t MCP79412Timebase::nextAlarm(uint8_t alarmNumber)
+{
+    tmElements_t alm, tm;
+    uint8_t type;
+    time_t t = now();
+    time_t next;
+
+    if (t == 0 || !m_rtc.readAlarm(alarmNumber, alm, &type)) return 0;
+    switch (type) {
+        case ALM_MATCH_SECONDS:
+            next = t - t % SECS_PER_MIN + alm.Second;
+            return (next > t) ? next : next + SECS_PER_MIN;
+        case ALM_MATCH_MINUTES:
+            next = t - t % SECS_PER_HOUR + alm.Minute * SECS_PER_MIN;
+            return (next > t) ? next : next + SECS_PER_HOUR;
+        case ALM_MATCH_HOURS:
+            next = previousMidnight(t) + alm.Hour * SECS_PER_HOUR;
+            return (next > t) ? next : next + SECS_PER_DAY;
+        case ALM_MATCH_DAY:
+            next = previousMidnight(t) + ((alm.Wday + 7 - dayOfWeek(t)) % 7) * SECS_PER_DAY;
+            return (next > t) ? next : next + SECS_PER_WEEK;
+        case ALM_MATCH_DATE:
+        case ALM_MATCH_DATETIME:
+            // try each month, or each year, until the date exists and is to come
+            breakTime(t, tm);
+            if (type == ALM_MATCH_DATE) {
+                alm.Second = alm.Minute = alm.Hour = 0;
+                alm.Month = tm.Month;
+            }
+            alm.Year = tm.Year;
+            for (byte i=0; i<13; i++) {
+                next = makeTime(alm);
+                breakTime(next, tm);
+                if (next > t && tm.Day == alm.Day) return next;
+                if (type == ALM_MATCH_DATETIME) {
+                    alm.Year++;
+                }
+                else if (++alm.Month > 12) {
+                    alm.Month = 1;
+                    alm.Year++;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// Set the wake-up time to the next time either alarm matches, and
+// return it, or zero if neither alarm is enabled.
+time_t MCP79412Timebase::wakeOnAlarms()
+{
+    time_t a0 = nextAlarm(ALARM_0);
+    time_t a1 = nextAlarm(ALARM_1);
+
+    m_wake = (a0 == 0 || (a1 != 0 && a1 < a0)) ? a1 : a0;
+    return m_wake;
+}
+
+// Returns true if the wake-up time has come.
+bool MCP79412Timebase::due()
+{
+    return m_wake != 0 && now() >= m_wake;
+}
+
+#ifdef __AVR__
+// Sleep until the wake-up time: in power-save with Timer2, which
+// keeps running, else in power-down, from which the 1Hz interrupt
+// must wake the MCU. Returns at once if there is no wake-up time.
+void MCP79412Timebase::sleep()
+{
+    if (m_rate == 0 || m_wake == 0) return;
+    while (!due()) {
+#ifdef MCP79412RTC_TIMER2
+        if (m_rate == TIMER2_RATE) {
+            // wake on a compare match if the time is due before the next overflow
+            uint32_t target = (uint32_t)(m_wake - m_base) * TIMER2_RATE;
+            uint32_t ahead = target - count();
+            if (ahead <= 2) continue;       // too close to set a compare in time
+            if (ahead < 256) {
+                OCR2A = (uint8_t)target;
+                timer2Wait();
+                TIFR2 = _BV(OCF2A);
+                TIMSK2 |= _BV(OCIE2A);
+            }
+            set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+        }
+        else
+#endif
+        set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+
+        cli();
+        if (due()) {
+            sei();
+            break;
+        }
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+#ifdef MCP79412RTC_TIMER2
+        // after a Timer2 wake-up, wait a cycle of its clock before
+        // reading TCNT2 or sleeping again
+        if (m_rate == TIMER2_RATE) {
+            OCR2B = 0;
+            timer2Wait();
+        }
+#endif
+    }
+#ifdef MCP79412RTC_TIMER2
+    if (m_rate == TIMER2_RATE) TIMSK2 &= ~_BV(OCIE2A);
+#endif
+}
+#endif
+
+// Returns the count: seconds, or 1/32 seconds with Timer2.
+uint32_t MCP79412Timebase::count()
+{
+    uint32_t c;
+
+#ifdef MCP79412RTC_TIMER2
+    if (m_rate == TIMER2_RATE) {
+        uint8_t sreg = SREG;
+        cli();
+        uint8_t t = TCNT2;
+        bool pending = TIFR2 & _BV(TOV2);
+        c = m_count;
+        SREG = sreg;
+        // TCNT2 wrapped, but the overflow interrupt has yet to run
+        if (pending && t < 128) c += 256;
+        return c + t;
+    }
+#endif
+    do {
+        c = m_count;
+    } while (c != m_count);
+    return c;
+}
@@ -0,0 +1,72 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// Keeps time on the MCU from the RTC's square wave, so that a battery
+// powered node can sleep with its main oscillator off and wake when
+// it has something to do, without waking to read the RTC.
+//
+// The time is read from the RTC once, at a seconds edge, by begin();
+// after that it is counted from the MFP's square wave in one of two
+// ways:
+//
+// - 32.768kHz, on an AVR with Timer2's asynchronous external clock
+//   input (EXCLK), e.g. the ATmega328P with the MFP on TOSC1, when the
+//   library is compiled with MCP79412RTC_TIMER2 defined. The library
+//   then owns Timer2 and its interrupts. Timer2 counts 1/32 seconds,
+//   and wakes the MCU from power-save sleep every 8 seconds, or when
+//   a wake-up time is due.
+// - 1Hz, on any MCU: the application attaches tick() to an interrupt
+//   on the edge at which the RTC's seconds change, which must be able
+//   to wake the MCU from its sleep mode (e.g. a pin change interrupt
+//   on an AVR in power-down). The MCU then wakes briefly each second.
+//
+// A wake-up time can be given with setWake(), or taken from the RTC's
+// alarms with wakeOnAlarms(): while the MFP puts out the square wave,
+// it cannot signal the alarms, but the RTC still sets the alarm flags,
+// so the next time that each enabled alarm matches is worked out from
+// its registers, and the application checks alarm() when it wakes.
+// As the count runs from the RTC's own oscillator it does not drift
+// from the RTC, apart from the calibration register's correction,
+// which the 32.768kHz output does not have; call begin() again from
+// time to time if it is used, e.g. daily.
+
+#ifndef MCP79412TIMEBASE_H_INCLUDED
+#define MCP79412TIMEBASE_H_INCLUDED
+
+#include <MCP79412RTC.h>
+#include <MCP79412Port.h>
+
+class MCP79412Timebase
+{
+    public:
+        MCP79412Timebase(MCP79412RTC &rtc);
+        bool begin(uint8_t freq = SQWAVE_1_HZ);
+        void tick() { m_count++; }
+        time_t now();
+        void setWake(time_t t) { m_wake = t; }
+        time_t nextAlarm(uint8_t alarmNumber);
+        time_t wakeOnAlarms();
+        bool due();
+#ifdef __AVR__
+        void sleep();
+#endif
+#ifdef MCP79412RTC_TIMER2
+        static void timer2Overflow();
+#endif
+
+    private:
+        uint32_t count();
+
+        MCP79412RTC &m_rtc;
+        byte m_rate;                // counts per second: 1, or 32 with Timer2; 0 before begin()
+        time_t m_base;              // RTC time at count 0
+        volatile uint32_t m_count;  // seconds, or 1/32 seconds less the count in TCNT2
+        time_t m_wake;              // wake-up time, 0 if none
+#ifdef MCP79412RTC_TIMER2
+        static MCP79412Timebase *m_timer2;  // the object using Timer2, for its interrupt
+#endif
+};
+
+#endif
@@ -0,0 +1,255 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// I2C bus traces for the MCP79412RTC driver. See MCP79412Trace.h for
+// details and the trace format.
+
+#include <MCP79412Trace.h>
+#include <MCP79412Port.h>
+#include <string.h>
+
+static const uint8_t traceHeader[TRACE_HEADER_SIZE] = { 'M', 'C', 'P', 'T', TRACE_VERSION };
+
+MCP79412TraceReader::MCP79412TraceReader(const uint8_t *trace, uint32_t length)
+    : m_trace(trace), m_length(length)
+{
+    m_valid = (length >= TRACE_HEADER_SIZE && memcmp(trace, traceHeader, TRACE_HEADER_SIZE) == 0);
+    rewind();
+}
+
+// Go back to the first record.
+void MCP79412TraceReader::rewind()
+{
+    m_pos = TRACE_HEADER_SIZE;
+    m_time = 0;
+    m_index = 0;
+}
+
+// Decode a varint at pos, advancing pos. Returns false if the trace
+// ends first.
+bool MCP79412TraceReader::readVarint(uint32_t &pos, uint32_t &value)
+{
+    value = 0;
+    for (uint8_t shift=0; shift<35; shift+=7)
+    {
+        if (pos >= m_length) return false;
+        uint8_t b = m_trace[pos++];
+        value |= (uint32_t)(b & 0x7F) << shift;
+        if ( !(b & 0x80) ) return true;
+    }
+    return false;
+}
+
+// Decode the next record without moving past it. Returns false at the
+// end of the trace, or if the rest of it is not valid.
+bool MCP79412TraceReader::peek(traceRecord_t &rec)
+{
+    uint32_t pos = m_pos;
+    uint32_t delta;
+
+    if (!m_valid || pos + 2 > m_length) return false;
+    uint8_t tag = m_trace[pos++];
+    rec.read = tag & TRACE_READ;
+    rec.truncated = tag & TRACE_TRUNCATED;
+    rec.status = tag & TRACE_STATUS;
+    rec.addr = m_trace[pos++];
+    if (!readVarint(pos, delta) || !readVarint(pos, rec.duration)) return false;
+    rec.start = (m_index == 0) ? 0 : m_time + delta;
+    if (pos >= m_length) return false;
+    rec.requested = rec.read ? m_trace[pos++] : 0;
+    if (pos >= m_length) return false;
+    rec.nData = m_trace[pos++];
+    if (pos + rec.nData > m_length) return false;
+    rec.data = m_trace + pos;
+    return true;
+}
+
+// Decode the next record and move past it. Returns false at the end
+// of the trace, or if the rest of it is not valid.
+bool MCP79412TraceReader::next(traceRecord_t &rec)
+{
+    if (!peek(rec)) return false;
+    m_pos = (rec.data - m_trace) + rec.nData;
+    m_time = rec.start;
+    m_index++;
+    return true;
+}
+
+MCP79412RecordBus::MCP79412RecordBus(MCP79412Bus &bus, traceWriter_t writer, void *context)
+    : m_bus(bus), m_writer(writer), m_context(context), m_started(false),
+      m_lastStart(0), m_records(0), m_addr(0), m_len(0), m_pos(0), m_truncated(false)
+{
+}
+
+void MCP79412RecordBus::begin()
+{
+    m_bus.begin();
+}
+
+void MCP79412RecordBus::beginTransmission(uint8_t addr)
+{
+    m_addr = addr;
+    m_len = 0;
+    m_truncated = false;
+    m_bus.beginTransmission(addr);
+}
+
+size_t MCP79412RecordBus::write(uint8_t value)
+{
+    if (m_len < MCP79412_TRACE_MAX_DATA)
+        m_data[m_len++] = value;
+    else
+        m_truncated = true;
+    return m_bus.write(value);
+}
+
+uint8_t MCP79412RecordBus::endTransmission()
+{
+    uint32_t start = MCP79412RTC_MICROS();
+    uint8_t status = m_bus.endTransmission();
+    uint32_t duration = MCP79412RTC_MICROS() - start;
+
+    emit( (m_truncated ? TRACE_TRUNCATED : 0) | (status & TRACE_STATUS),
+        m_addr, start, duration, 0, m_len );
+    m_len = 0;
+    return status;
+}
+
+// The bytes read are taken from the bus at once, to be recorded, and
+// returned by read() from here.
+uint8_t MCP79412RecordBus::requestFrom(uint8_t addr, uint8_t nBytes)
+{
+    uint32_t start = MCP79412RTC_MICROS();
+    uint8_t n = m_bus.requestFrom(addr, nBytes);
+    uint32_t duration = MCP79412RTC_MICROS() - start;
+
+    if (n > MCP79412_TRACE_MAX_DATA) n = MCP79412_TRACE_MAX_DATA;
+    for (uint8_t i=0; i<n; i++) m_data[i] = m_bus.read();
+    emit( TRACE_READ | (n < nBytes ? 1 : 0), addr, start, duration, nBytes, n );
+    m_len = n;
+    m_pos = 0;
+    return n;
+}
+
+int MCP79412RecordBus::read()
+{
+    return (m_pos < m_len) ? m_data[m_pos++] : -1;
+}
+
+// Write a record, and the header before the first one.
+void MCP79412RecordBus::emit(uint8_t tag, uint8_t addr, uint32_t start, uint32_t duration,
+    uint8_t requested, uint8_t nData)
+{
+    uint8_t buf[16];
+    uint8_t n = 0;
+    uint32_t v[2];
+
+    if (!m_started)
+    {
+        m_writer(traceHeader, TRACE_HEADER_SIZE, m_context);
+        m_lastStart = start;
+        m_started = true;
+    }
+    v[0] = start - m_lastStart;
+    v[1] = duration;
+    m_lastStart = start;
+
+    buf[n++] = tag;
+    buf[n++] = addr;
+    for (uint8_t i=0; i<2; i++)
+    {
+        while (v[i] >= 0x80)
+        {
+            buf[n++] = (v[i] & 0x7F) | 0x80;
+            v[i] >>= 7;
+        }
+        buf[n++] = v[i];
+    }
+    if (tag & TRACE_READ) buf[n++] = requested;
+    buf[n++] = nData;
+    m_writer(buf, n, m_context);
+    if (nData) m_writer(m_data, nData, m_context);
+    m_records++;
+}
+
+MCP79412ReplayBus::MCP79412ReplayBus(const uint8_t *trace, uint32_t length)
+    : m_reader(trace, length), m_mismatches(0), m_firstMismatch(0xFFFFFFFF),
+      m_busMicros(0), m_addr(0), m_len(0), m_rxData(0), m_rxLen(0), m_rxPos(0)
+{
+}
+
+// Returns true when all the records in the trace have been replayed.
+bool MCP79412ReplayBus::done()
+{
+    traceRecord_t rec;
+    return !m_reader.peek(rec);
+}
+
+void MCP79412ReplayBus::mismatch()
+{
+    if (m_mismatches++ == 0) m_firstMismatch = m_reader.index();
+}
+
+void MCP79412ReplayBus::beginTransmission(uint8_t addr)
+{
+    m_addr = addr;
+    m_len = 0;
+}
+
+size_t MCP79412ReplayBus::write(uint8_t value)
+{
+    if (m_len < MCP79412_TRACE_MAX_DATA) m_data[m_len++] = value;
+    return 1;
+}
+
+// Returns the recorded status of the write. A write that differs from
+// the trace, in address or data, is counted as a mismatch but still
+// replayed; if the next record is not a write, it is not used and the
+// write fails with status 4.
+uint8_t MCP79412ReplayBus::endTransmission()
+{
+    traceRecord_t rec;
+
+    if (!m_reader.peek(rec) || rec.read)
+    {
+        mismatch();
+        return 4;
+    }
+    if (rec.addr != m_addr || rec.nData > m_len || (!rec.truncated && rec.nData != m_len)
+        || memcmp(rec.data, m_data, rec.nData) != 0)
+    {
+        mismatch();
+    }
+    m_reader.next(rec);
+    m_busMicros += rec.duration;
+    return rec.status;
+}
+
+// Returns the bytes recorded for the read, which read() then returns.
+// If the next record is not a read of the same address, it is not
+// used and no bytes are returned.
+uint8_t MCP79412ReplayBus::requestFrom(uint8_t addr, uint8_t nBytes)
+{
+    traceRecord_t rec;
+
+    m_rxLen = 0;
+    m_rxPos = 0;
+    if (!m_reader.peek(rec) || !rec.read || rec.addr != addr)
+    {
+        mismatch();
+        return 0;
+    }
+    if (rec.requested != nBytes) mismatch();
+    m_reader.next(rec);
+    m_busMicros += rec.duration;
+    m_rxData = rec.data;
+    m_rxLen = (rec.nData < nBytes) ? rec.nData : nBytes;
+    return m_rxLen;
+}
+
+int MCP79412ReplayBus::read()
+{
+    return (m_rxPos < m_rxLen) ? m_rxData[m_rxPos++] : -1;
+}
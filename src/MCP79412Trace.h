@@ -0,0 +1,155 @@
+// Arduino MCP79412RTC Library
+// https://github.com/JChristensen/MCP79412RTC
+// Copyright (C) 2018 by Jack Christensen and licensed under
+// GNU GPL v3.0, https://www.gnu.org/licenses/gpl.html
+//
+// I2C bus traces for the MCP79412RTC driver.
+//
+//   MCP79412RecordBus   passes the driver's transactions through to
+//                       another bus and records each one to a trace.
+//   MCP79412ReplayBus   plays the device's side of a trace back to
+//                       the driver, with no hardware, e.g. to repeat
+//                       on a Linux host what a field unit did.
+//   MCP79412TraceReader decodes a trace.
+//
+// A trace is a 5-byte header, "MCPT" and the format version, followed
+// by one record per transaction:
+//
+//   tag         bit 7: 1 read (requestFrom), 0 write (endTransmission)
+//               bit 6: 1 if the written data was truncated
+//               bits 2-0: status; for a write, the endTransmission()
+//               return value (0 ACK, 2 address NACK, 3 data NACK,
+//               4 other); for a read, 1 if fewer bytes were returned
+//               than requested (address NACK), else 0
+//   addr        7-bit I2C address
+//   start       microseconds since the start of the previous record
+//               (since the first transaction, for the first record)
+//   duration    microseconds the transaction took
+//   write:      n, then n bytes written
+//   read:       n requested, m returned, then m bytes read
+//
+// start and duration are unsigned LEB128 varints (7 bits per byte,
+// least significant first, high bit set on all but the last byte).
+// The 7-byte read of the time by get() takes at most 15 bytes.
+//
+// The recorder writes the trace through a caller-provided function,
+// e.g. to a Serial port, an SD card file, or a RAM buffer to be saved
+// later; it takes the time with MCP79412RTC_MICROS() (see
+// MCP79412Port.h).
+
+#ifndef MCP79412TRACE_H_INCLUDED
+#define MCP79412TRACE_H_INCLUDED
+
+#include <MCP79412Bus.h>
+
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 5
+#define TRACE_READ 0x80         // tag bits
+#define TRACE_TRUNCATED 0x40
+#define TRACE_STATUS 0x07
+
+// Longest write recorded in full; longer writes are truncated
+#ifndef MCP79412_TRACE_MAX_DATA
+#define MCP79412_TRACE_MAX_DATA 32
+#endif
+
+// A trace record, as returned by MCP79412TraceReader::next()
+struct traceRecord_t {
+    bool read;              // true for requestFrom, false for endTransmission
+    bool truncated;         // written data was truncated
+    uint8_t status;         // see above
+    uint8_t addr;           // 7-bit I2C address
+    uint8_t requested;      // bytes requested, for a read
+    uint8_t nData;          // bytes written or read
+    const uint8_t *data;    // the bytes, in the trace
+    uint32_t start;         // microseconds since the first record
+    uint32_t duration;      // microseconds
+};
+
+// Function called by MCP79412RecordBus to write trace bytes
+typedef void (*traceWriter_t)(const uint8_t *data, uint8_t nBytes, void *context);
+
+class MCP79412TraceReader
+{
+    public:
+        MCP79412TraceReader(const uint8_t *trace, uint32_t length);
+        bool valid() { return m_valid; }
+        bool next(traceRecord_t &rec);
+        bool peek(traceRecord_t &rec);
+        void rewind();
+        uint32_t index() { return m_index; }        // number of records read
+        bool atEnd() { return m_pos >= m_length; }
+
+    private:
+        bool readVarint(uint32_t &pos, uint32_t &value);
+
+        const uint8_t *m_trace;
+        uint32_t m_length;
+        uint32_t m_pos;         // offset of the next record
+        uint32_t m_time;        // start time of the last record read
+        uint32_t m_index;
+        bool m_valid;           // header is good
+};
+
+class MCP79412RecordBus : public MCP79412Bus
+{
+    public:
+        MCP79412RecordBus(MCP79412Bus &bus, traceWriter_t writer, void *context = 0);
+        void begin();
+        void beginTransmission(uint8_t addr);
+        size_t write(uint8_t value);
+        uint8_t endTransmission();
+        uint8_t requestFrom(uint8_t addr, uint8_t nBytes);
+        int read();
+        bool recover() { return m_bus.recover(); }
+        uint32_t records() { return m_records; }
+
+    private:
+        void emit(uint8_t tag, uint8_t addr, uint32_t start, uint32_t duration,
+            uint8_t requested, uint8_t nData);
+
+        MCP79412Bus &m_bus;             // the bus being recorded
+        traceWriter_t m_writer;
+        void *m_context;                // passed to m_writer
+        bool m_started;                 // header written
+        uint32_t m_lastStart;           // start time of the previous record
+        uint32_t m_records;
+        uint8_t m_addr;                 // address for the current write
+        uint8_t m_len;                  // bytes written, or read and not yet returned
+        uint8_t m_pos;                  // next byte to return from read()
+        bool m_truncated;
+        uint8_t m_data[MCP79412_TRACE_MAX_DATA];
+};
+
+class MCP79412ReplayBus : public MCP79412Bus
+{
+    public:
+        MCP79412ReplayBus(const uint8_t *trace, uint32_t length);
+        void begin() {}
+        void beginTransmission(uint8_t addr);
+        size_t write(uint8_t value);
+        uint8_t endTransmission();
+        uint8_t requestFrom(uint8_t addr, uint8_t nBytes);
+        int read();
+        bool valid() { return m_reader.valid(); }
+        bool done();
+        uint32_t mismatches() { return m_mismatches; }
+        uint32_t firstMismatch() { return m_firstMismatch; }
+        uint32_t busMicros() { return m_busMicros; }
+
+    private:
+        void mismatch();
+
+        MCP79412TraceReader m_reader;
+        uint32_t m_mismatches;          // transactions that differ from the trace
+        uint32_t m_firstMismatch;       // record index of the first, 0xFFFFFFFF if none
+        uint32_t m_busMicros;           // recorded duration of the transactions replayed
+        uint8_t m_addr;                 // address for the current write
+        uint8_t m_len;                  // bytes written
+        uint8_t m_data[MCP79412_TRACE_MAX_DATA];
+        const uint8_t *m_rxData;        // data of the current read, in the trace
+        uint8_t m_rxLen;
+        uint8_t m_rxPos;
+};
+
+#endif